@@ -0,0 +1,127 @@
+#include "BeamSearch.h"
+#include <algorithm>
+
+namespace ai {
+
+    using game::BOARD_W;
+    using game::BOARD_H;
+
+    // Per-thread scratch: a game to replay snapshots into and a placement list
+    struct BeamSearch::Worker {
+        game::Game scratch;
+        game::PlacementList<BOARD_W, BOARD_H> list;
+    };
+
+    namespace {
+        // Best first; equal values fall back to position so the ranking is a total order
+        bool Better(const auto& a, const auto& b) {
+            if (a.value != b.value) return a.value > b.value;
+            if (a.parent != b.parent) return a.parent < b.parent;
+            return a.index < b.index;
+        }
+    }
+
+    BeamSearch::BeamSearch(const SearchParams& p, const Weights& w)
+        : m_Params(p), m_Weights(w), m_Scheduler(p.threads) {
+        m_Params.width = std::max(1, m_Params.width);
+        m_Params.depth = std::max(1, m_Params.depth);
+        for (int i = 0; i < m_Scheduler.Size(); ++i) m_Workers.push_back(std::make_unique<Worker>());
+        m_Frontier.reserve(m_Params.width);
+        m_Next.reserve(m_Params.width);
+    }
+
+    BeamSearch::~BeamSearch() = default;
+
+    // Score every placement of the node's active piece that keeps the game going
+    void BeamSearch::expand(int i, int worker) {
+        Worker& w = *m_Workers[worker];
+        const Node& node = m_Frontier[i];
+        std::vector<Candidate>& out = m_Children[i];
+        out.clear();
+        game::Restore(w.scratch, node.snap);
+        game::GeneratePlacements(w.scratch, w.scratch.cur.type, w.list);
+        bool scan = UsesRowScan(m_Weights);
+        for (int k = 0; k < w.list.count; ++k) {
+            game::Active a = w.list[k];
+            const auto& pm = game::PIECE_MASKS<BOARD_W>[a.type][a.r][game::MASK_X_BIAS];
+            if (a.y + pm.maxY >= BOARD_H) continue; // cells above the ceiling would be lost
+            game::Restore(w.scratch, node.snap);
+            w.scratch.cur = a;
+            game::lockPiece(w.scratch);
+            int lines = node.lines + game::clearLines(w.scratch);
+            if (w.scratch.bag.queueCount > 0) game::spawn(w.scratch); // never deal past the preview
+            if (w.scratch.gameOver) continue;
+            out.push_back({ Evaluate(m_Weights, Measure(w.scratch, lines, scan)), i, k, lines, a, w.scratch.boardHash });
+        }
+        m_Nodes.fetch_add(w.list.count, std::memory_order_relaxed);
+    }
+
+    // Play a kept candidate onto its parent's board for the next ply
+    void BeamSearch::materialize(int slot, int worker, int ply) {
+        Worker& w = *m_Workers[worker];
+        const Candidate& c = m_Ranked[slot];
+        const Node& parent = m_Frontier[c.parent];
+        game::Restore(w.scratch, parent.snap);
+        w.scratch.cur = c.placement;
+        game::lockPiece(w.scratch);
+        game::clearLines(w.scratch);
+        if (w.scratch.bag.queueCount > 0) game::spawn(w.scratch);
+        Node& n = m_Next[slot];
+        game::Save(w.scratch, n.snap);
+        n.value = c.value;
+        n.first = ply == 0 ? c.index : parent.first;
+        n.lines = c.lines;
+    }
+
+    const Plan& BeamSearch::Think(const game::Game& g) {
+        m_Plan.valid = false;
+        m_Plan.moveCount = 0;
+        if (g.gameOver) return m_Plan;
+
+        m_Frontier.resize(1);
+        game::Save(g, m_Frontier[0].snap);
+        m_Frontier[0].value = 0.0f; m_Frontier[0].first = -1; m_Frontier[0].lines = 0;
+
+        // Only the active piece and the visible queue are known; the bag's RNG is not ours to read
+        int depth = std::min(m_Params.depth, 1 + g.bag.queueCount);
+        m_Scheduler.Run([&] {
+            for (int ply = 0; ply < depth; ++ply) {
+                int n = (int)m_Frontier.size();
+                if ((int)m_Children.size() < n) m_Children.resize(n);
+                m_Scheduler.ParallelFor(0, n, 1, [&](int i) { expand(i, eng::Scheduler::WorkerIndex()); });
+
+                m_Ranked.clear();
+                for (int i = 0; i < n; ++i) m_Ranked.insert(m_Ranked.end(), m_Children[i].begin(), m_Children[i].end());
+                if (m_Ranked.empty()) break; // every line of play tops out here: go with the last ply
+                std::sort(m_Ranked.begin(), m_Ranked.end(), [](const Candidate& a, const Candidate& b) {
+                    return a.board != b.board ? a.board < b.board : Better(a, b);
+                });
+                m_Ranked.erase(std::unique(m_Ranked.begin(), m_Ranked.end(),
+                    [](const Candidate& a, const Candidate& b) { return a.board == b.board; }), m_Ranked.end());
+                int keep = std::min((int)m_Ranked.size(), m_Params.width);
+                std::nth_element(m_Ranked.begin(), m_Ranked.begin() + (keep - 1), m_Ranked.end(),
+                    [](const Candidate& a, const Candidate& b) { return Better(a, b); });
+                m_Ranked.resize(keep);
+
+                m_Next.resize(keep);
+                m_Scheduler.ParallelFor(0, keep, 4, [&](int i) { materialize(i, eng::Scheduler::WorkerIndex(), ply); });
+                std::swap(m_Frontier, m_Next);
+            }
+        });
+
+        const Node* best = nullptr;
+        for (const Node& node : m_Frontier)
+            if (node.first >= 0 && (!best || node.value > best->value || (node.value == best->value && node.first < best->first)))
+                best = &node;
+        if (!best) return m_Plan;
+
+        // The root's placements come out in the same order every time, so the index carries over
+        game::GeneratePlacements(g, g.cur.type, m_RootList);
+        m_Plan.valid = true;
+        m_Plan.score = best->value;
+        m_Plan.target = m_RootList[best->first];
+        m_Plan.moveCount = std::min(m_RootList.Path(best->first, m_Plan.moves, Plan::MAX_MOVES, m_Plan.after), Plan::MAX_MOVES);
+        return m_Plan;
+    }
+
+} // namespace ai
@@ -0,0 +1,65 @@
+#pragma once
+#include "Player.h"
+#include "../engine/Scheduler.h"
+#include <memory>
+#include <vector>
+
+namespace ai {
+
+    struct SearchParams {
+        int width = 64;  // boards kept per ply
+        int depth = 6;   // pieces placed: the active one, then the queue; at most 1 + queueCount
+        int threads = 0; // 0: one per hardware thread
+    };
+
+    // Beam search over the known piece sequence: the active piece and the queued preview, never
+    // pieces still to be dealt from the bag. Each ply places the next piece in every reachable
+    // way on every kept board, scores the results with the weighted features (lines summed
+    // along the way) and keeps the `width` best; the plan is the first placement of the best
+    // board after `depth` plies. Boards of a ply are expanded in parallel, and ties are broken
+    // by position, so the answer does not depend on the thread count. Every line of play
+    // places the same pieces, so candidates with the same board hash are the same position
+    // and only the best of them is kept.
+    class BeamSearch : public Planner {
+    public:
+        explicit BeamSearch(const SearchParams& p = {}, const Weights& w = {});
+        ~BeamSearch() override;
+
+        const Plan& Think(const game::Game& g) override;
+
+        const SearchParams& Params() const { return m_Params; }
+        int Threads() const { return m_Scheduler.Size(); }
+        std::uint64_t NodesExpanded() const { return m_Nodes; } // placements scored, all calls
+
+    private:
+        struct Node {
+            game::GameSnapshot snap; // board with the next piece spawned
+            float value;
+            int first;               // root placement this board descends from
+            int lines;               // lines cleared since the root
+        };
+        struct Candidate {
+            float value;
+            int parent, index; // frontier node, placement within it
+            int lines;
+            game::Active placement;
+            std::uint64_t board; // board hash after the placement
+        };
+        struct Worker;
+
+        void expand(int node, int worker);
+        void materialize(int slot, int worker, int ply);
+
+        SearchParams m_Params;
+        Weights m_Weights;
+        eng::Scheduler m_Scheduler;
+        std::vector<std::unique_ptr<Worker>> m_Workers;
+        std::vector<Node> m_Frontier, m_Next;
+        std::vector<std::vector<Candidate>> m_Children; // per frontier node
+        std::vector<Candidate> m_Ranked;
+        std::atomic<std::uint64_t> m_Nodes{ 0 };
+        game::PlacementList<game::BOARD_W, game::BOARD_H> m_RootList;
+        Plan m_Plan;
+    };
+
+} // namespace ai
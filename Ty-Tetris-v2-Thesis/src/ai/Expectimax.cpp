@@ -0,0 +1,181 @@
+#include "Expectimax.h"
+#include "../game/Zobrist.h"
+#include <algorithm>
+
+namespace ai {
+
+    using game::BOARD_W;
+    using game::BOARD_H;
+
+    // Per-thread scratch, only used between forks: a game to replay snapshots into and a placement list
+    struct Expectimax::Worker {
+        game::Game scratch;
+        game::PlacementList<BOARD_W, BOARD_H> list;
+    };
+
+    Expectimax::Expectimax(const ExpectimaxParams& p, const Weights& w)
+        : m_Params(p), m_Weights(w), m_Scheduler(p.threads) {
+        m_Params.depth = std::max(1, m_Params.depth);
+        m_Params.branch = std::clamp(m_Params.branch, 1, MAX_BRANCH);
+        for (int i = 0; i < m_Scheduler.Size(); ++i) m_Workers.push_back(std::make_unique<Worker>());
+        if (m_Params.hashMegabytes > 0) m_Table = std::make_unique<TransTable>((std::size_t)m_Params.hashMegabytes);
+    }
+
+    Expectimax::~Expectimax() = default;
+
+    // The `branch` best placements of the active piece by static score, best first (ties by
+    // placement order). Returns how many there are; 0 when every placement tops out.
+    // Expects `s` restored into the worker's scratch game.
+    int Expectimax::expand(const game::GameSnapshot& s, Child* out) {
+        Worker& w = *m_Workers[eng::Scheduler::WorkerIndex()];
+        game::GeneratePlacements(w.scratch, w.scratch.cur.type, w.list);
+        int n = 0;
+        bool scan = UsesRowScan(m_Weights);
+        for (int k = 0; k < w.list.count; ++k) {
+            game::Active a = w.list[k];
+            const auto& pm = game::PIECE_MASKS<BOARD_W>[a.type][a.r][game::MASK_X_BIAS];
+            if (a.y + pm.maxY >= BOARD_H) continue; // cells above the ceiling would be lost
+            game::Restore(w.scratch, s);
+            w.scratch.cur = a;
+            game::lockPiece(w.scratch);
+            int l = game::clearLines(w.scratch);
+            float v = Evaluate(m_Weights, Measure(w.scratch, l, scan));
+            int at = n < m_Params.branch ? n++ : m_Params.branch;
+            while (at > 0 && v > out[at - 1].value) {
+                if (at < m_Params.branch) out[at] = out[at - 1];
+                --at;
+            }
+            if (at < m_Params.branch) { out[at].value = v; out[at].index = k; out[at].lines = l; }
+        }
+        m_Nodes.fetch_add(w.list.count, std::memory_order_relaxed);
+
+        // Only the kept placements are played out again to save their boards
+        for (int i = 0; i < n; ++i) {
+            game::Restore(w.scratch, s);
+            w.scratch.cur = w.list[out[i].index];
+            game::lockPiece(w.scratch);
+            game::clearLines(w.scratch);
+            game::Save(w.scratch, out[i].snap);
+        }
+        return n;
+    }
+
+    // Children searched in parallel, `depth` pieces still to place after them; returns the best
+    float Expectimax::searchChildren(Child* kids, int n, int depth) {
+        if (n == 0) return TOP_OUT;
+        if (depth > 0) {
+            float perLine = m_Weights.lines;
+            eng::Scheduler::TaskGroup group(m_Scheduler);
+            for (int i = 1; i < n; ++i) {
+                Child* c = &kids[i];
+                group.Spawn([this, c, depth, perLine] { c->value = perLine * c->lines + nextPiece(*c, depth); });
+            }
+            kids[0].value = perLine * kids[0].lines + nextPiece(kids[0], depth);
+            group.Wait();
+        }
+        float best = kids[0].value;
+        for (int i = 1; i < n; ++i) best = std::max(best, kids[i].value);
+        return best;
+    }
+
+    // Max node: the active piece of `s` is placed in the best way
+    float Expectimax::pieceNode(const game::GameSnapshot& s, int depth) {
+        Worker& w = *m_Workers[eng::Scheduler::WorkerIndex()];
+        game::Restore(w.scratch, s);
+        std::uint64_t key = 0;
+        float value;
+        if (m_Table) {
+            key = game::spawnKey(w.scratch, m_Params.mirror);
+            if (m_Table->Probe(key, depth, value)) { m_Hits.fetch_add(1, std::memory_order_relaxed); return value; }
+        }
+        Child kids[MAX_BRANCH];
+        int n = expand(s, kids);
+        value = searchChildren(kids, n, depth - 1);
+        if (m_Table) m_Table->Store(key, depth, value);
+        return value;
+    }
+
+    // Spawn the piece after `c`: straight from the queue when it is known, otherwise a chance
+    // node averaging over every piece the bag can still deal
+    float Expectimax::nextPiece(const Child& c, int depth) {
+        Worker& w = *m_Workers[eng::Scheduler::WorkerIndex()];
+        game::Restore(w.scratch, c.snap);
+        if (w.scratch.bag.queueCount > 0) {
+            game::spawn(w.scratch);
+            if (w.scratch.gameOver) return TOP_OUT;
+            game::GameSnapshot next;
+            game::Save(w.scratch, next);
+            return pieceNode(next, depth);
+        }
+
+        std::int8_t types[7];
+        int outcomes = w.scratch.bag.bagCount;
+        if (outcomes > 0) std::copy_n(w.scratch.bag.bag, outcomes, types);
+        else for (outcomes = 0; outcomes < 7; ++outcomes) types[outcomes] = (std::int8_t)outcomes;
+
+        struct Outcome { game::GameSnapshot snap; float value; bool lost; };
+        Outcome outs[7];
+        for (int i = 0; i < outcomes; ++i) {
+            game::Restore(w.scratch, c.snap);
+            game::Bag7& bag = w.scratch.bag;
+            // Deal types[i] from the bag by hand (a fresh bag keeps the other six), then
+            // spawn it through the queue
+            if (bag.bagCount == 0) {
+                for (int t = 0; t < 7; ++t) if (t != types[i]) bag.bag[bag.bagCount++] = (std::int8_t)t;
+            }
+            else {
+                std::int8_t* at = std::find(bag.bag, bag.bag + bag.bagCount, types[i]);
+                *at = bag.bag[--bag.bagCount];
+            }
+            bag.queue[bag.queueHead] = types[i];
+            bag.queueCount = 1;
+            game::spawn(w.scratch);
+            outs[i].lost = w.scratch.gameOver;
+            outs[i].value = TOP_OUT;
+            game::Save(w.scratch, outs[i].snap);
+        }
+
+        {
+            eng::Scheduler::TaskGroup group(m_Scheduler);
+            for (int i = 0; i < outcomes; ++i) {
+                if (outs[i].lost) continue;
+                Outcome* o = &outs[i];
+                group.Spawn([this, o, depth] { o->value = pieceNode(o->snap, depth); });
+            }
+        }
+        float sum = 0.0f;
+        for (int i = 0; i < outcomes; ++i) sum += outs[i].value;
+        return sum / outcomes;
+    }
+
+    const Plan& Expectimax::Think(const game::Game& g) {
+        m_Plan.valid = false;
+        m_Plan.moveCount = 0;
+        if (g.gameOver) return m_Plan;
+
+        game::GameSnapshot root;
+        game::Save(g, root);
+        Child kids[MAX_BRANCH];
+        int n = 0;
+        if (m_Table) m_Table->NewSearch();
+        m_Scheduler.Run([&] {
+            game::Restore(m_Workers[0]->scratch, root);
+            n = expand(root, kids);
+            searchChildren(kids, n, m_Params.depth - 1);
+        });
+        if (n == 0) return m_Plan;
+
+        int best = 0;
+        for (int i = 1; i < n; ++i)
+            if (kids[i].value > kids[best].value) best = i;
+
+        // The root's placements come out in the same order every time, so the index carries over
+        game::GeneratePlacements(g, g.cur.type, m_RootList);
+        m_Plan.valid = true;
+        m_Plan.score = kids[best].value;
+        m_Plan.target = m_RootList[kids[best].index];
+        m_Plan.moveCount = std::min(m_RootList.Path(kids[best].index, m_Plan.moves, Plan::MAX_MOVES, m_Plan.after), Plan::MAX_MOVES);
+        return m_Plan;
+    }
+
+} // namespace ai
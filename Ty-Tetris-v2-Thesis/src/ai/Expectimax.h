@@ -0,0 +1,67 @@
+#pragma once
+#include "Player.h"
+#include "TransTable.h"
+#include "../engine/Scheduler.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace ai {
+
+    struct ExpectimaxParams {
+        int depth = 3;   // pieces placed along every line of play
+        int branch = 6;  // placements searched per piece: the best by static score
+        int threads = 0; // 0: one per hardware thread
+        int hashMegabytes = 64; // transposition table shared by the threads; 0 for none
+        bool mirror = false;    // share entries between mirror-image positions (approximate)
+    };
+
+    // Expectimax over the piece sequence. Queued pieces are known; past the queue the next
+    // piece is a chance node, uniform over what is left in the 7-bag. At each piece only the
+    // `branch` placements with the best static score are searched further. Subtrees are
+    // forked onto a work-stealing scheduler, so uneven ones (chance nodes fan out 7 ways,
+    // known pieces do not) balance themselves; children are combined in a fixed order, so
+    // the answer does not depend on the thread count. A node's value counts only the lines
+    // cleared below it, so it depends on the position alone: positions reached again by
+    // another move order (or by another thread) come from the transposition table.
+    class Expectimax : public Planner {
+    public:
+        static constexpr int MAX_BRANCH = 16;
+        static constexpr float TOP_OUT = -1.0e6f; // value of a line of play that loses the game
+
+        explicit Expectimax(const ExpectimaxParams& p = {}, const Weights& w = {});
+        ~Expectimax() override;
+
+        const Plan& Think(const game::Game& g) override;
+
+        const ExpectimaxParams& Params() const { return m_Params; }
+        int Threads() const { return m_Scheduler.Size(); }
+        std::uint64_t NodesExpanded() const { return m_Nodes; } // placements scored, all calls
+        std::uint64_t HashHits() const { return m_Hits; }
+        const TransTable* Table() const { return m_Table.get(); }
+
+    private:
+        struct Child {
+            game::GameSnapshot snap; // board after the placement, next piece not yet spawned
+            float value;
+            int index;               // placement within the parent's list
+            int lines;               // lines the placement cleared
+        };
+        struct Worker;
+
+        int expand(const game::GameSnapshot& s, Child* out);
+        float pieceNode(const game::GameSnapshot& s, int depth);
+        float nextPiece(const Child& c, int depth);
+        float searchChildren(Child* kids, int n, int depth);
+
+        ExpectimaxParams m_Params;
+        Weights m_Weights;
+        eng::Scheduler m_Scheduler;
+        std::vector<std::unique_ptr<Worker>> m_Workers;
+        std::unique_ptr<TransTable> m_Table;
+        std::atomic<std::uint64_t> m_Nodes{ 0 }, m_Hits{ 0 };
+        game::PlacementList<game::BOARD_W, game::BOARD_H> m_RootList;
+        Plan m_Plan;
+    };
+
+} // namespace ai
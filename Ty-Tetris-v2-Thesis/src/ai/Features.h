@@ -0,0 +1,226 @@
+#pragma once
+#include "../game/Tetris.h"
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#if defined(__BMI2__) || (defined(_MSC_VER) && defined(__AVX2__))
+#include <immintrin.h>
+#define TETRIS_HAS_PEXT 1
+#endif
+
+namespace ai {
+
+    // Board features after a placement locks and its lines clear
+    struct Features {
+        int aggregateHeight; // sum of column heights
+        int holes;           // empty cells under their column's surface
+        int bumpiness;       // sum of height differences between neighbouring columns
+        int wells;           // summed depth of every well (walls count as tall)
+        int lines;           // lines the placement cleared
+        int coveredCells;    // filled cells with a hole somewhere below them in their column
+        int rowTransitions;  // filled/empty changes along every row; the walls count as filled
+        int colTransitions;  // filled/empty changes up every column; the floor counts as filled
+        int wellSums;        // a run of d open well cells counts 1 + 2 + ... + d (walls count as filled)
+    };
+
+    // Feature kernels over the occupancy bitmasks. The row-major kernel works on the rows
+    // as stored, with shifts and popcounts, and takes the heights and holes the game already
+    // keeps. The column kernel works on a transposed copy of the board (one H-bit mask per
+    // column, built with PEXT where BMI2 is available) and derives everything, heights
+    // included, from bit_width and popcount. Both give the same numbers; Measure uses the
+    // row-major one, which needs no transpose (and PEXT is microcoded on some CPUs).
+    namespace kernels {
+
+        template <int H>
+        using ColumnBits = std::conditional_t<(H <= 32), std::uint32_t, std::uint64_t>;
+
+        // Aggregate height, bumpiness and summed well depth from the column heights
+        template <int W, int H, class T>
+        void fromHeights(const T* heights, Features& f) {
+            f.aggregateHeight = 0; f.bumpiness = 0; f.wells = 0;
+            for (int x = 0; x < W; ++x) {
+                int h = heights[x];
+                int l = x > 0 ? heights[x - 1] : H;
+                int r = x < W - 1 ? heights[x + 1] : H;
+                f.aggregateHeight += h;
+                if (x > 0) f.bumpiness += h > l ? h - l : l - h;
+                int m = l < r ? l : r;
+                if (m > h) f.wells += m - h;
+            }
+        }
+
+        // Covered cells, row and column transitions and well sums from the occupancy rows.
+        // Rows of 9 to 14 cells (the standard board) go four to a 64-bit word, with room in
+        // each 16-bit lane for both walls, so one popcount covers four rows; the masks that
+        // depend on other rows (empty below, open above) become prefix ORs across the lanes.
+        // Other widths go a row at a time, with well runs kept in bit-sliced counters: plane
+        // b holds bit b of every column's current run length.
+        template <int W, int H>
+        void fromRows(const game::BasicGame<W, H>& g, Features& f) {
+            using Row = typename game::BasicGame<W, H>::Row;
+            constexpr Row FULL = game::BasicGame<W, H>::FULL_ROW;
+            constexpr Row LEFT_WALL = 1, RIGHT_WALL = (Row)(Row(1) << (W - 1));
+
+            int covered = 0, rowT = 0, colT = 0, wellSums = 0;
+            if constexpr (W > 8 && W <= 14 && std::endian::native == std::endian::little) {
+                constexpr std::uint64_t LANES = 0x0001000100010001ull;
+                constexpr std::uint64_t FULLS = FULL * LANES, PAIRS = ((2ull << W) - 1) * LANES;
+                constexpr std::uint64_t LEFTS = LEFT_WALL * LANES, RIGHTS = RIGHT_WALL * LANES;
+                constexpr int WORDS = (H + 3) / 4, SLOTS = game::BasicGame<W, H>::ROW_SLOTS;
+                constexpr std::uint64_t LAST = H % 4 ? (1ull << (16 * (H % 4))) - 1 : ~0ull; // lanes on the board
+
+                // Down the board: pack the rows and mark the cells with nothing filled at or above.
+                // The empty rows above the stack need no special case: they add their two wall
+                // transitions and nothing else.
+                std::uint64_t packed[WORDS], open[WORDS], wells[WORDS];
+                std::uint64_t seen = 0;
+                for (int k = WORDS - 1; k >= 0; --k) {
+                    std::uint64_t p = 0;
+                    int first = g.slot(4 * k);
+                    if (first + 4 <= SLOTS && 4 * k + 4 <= H) std::memcpy(&p, g.rowSlots + first, sizeof p);
+                    else for (int i = 0; i < 4 && 4 * k + i < H; ++i) p |= (std::uint64_t)g.row(4 * k + i) << (16 * i);
+                    std::uint64_t s = p | (p >> 16);
+                    s |= s >> 32;
+                    s |= seen;
+                    seen = (s & FULL) * LANES;
+                    packed[k] = p;
+                    open[k] = ~s & FULLS;
+                }
+
+                // Up the board: transitions, covered cells and the well cells
+                std::uint64_t below = FULL, emptyBelow = 0, anyWell = 0;
+                for (int k = 0; k < WORDS; ++k) {
+                    std::uint64_t p = packed[k];
+                    std::uint64_t valid = k == WORDS - 1 ? LAST : ~0ull;
+
+                    // The walls count as filled: W + 1 neighbouring pairs per row
+                    std::uint64_t walled = (p << 1) | LEFTS | (LEFTS << (W + 1));
+                    rowT += std::popcount((walled ^ (walled >> 1)) & PAIRS & valid);
+                    colT += std::popcount((p ^ ((p << 16) | below)) & valid);
+                    below = p >> 48;
+
+                    std::uint64_t e = ~p & FULLS;
+                    e |= e << 16;
+                    e |= e << 32;
+                    covered += std::popcount(p & ((e << 16) | emptyBelow));
+                    emptyBelow |= (e >> 48) * LANES;
+
+                    wells[k] = open[k] & ((p << 1) | LEFTS) & ((p >> 1) | RIGHTS) & valid;
+                    anyWell |= wells[k];
+                }
+
+                // A run of d well cells adds 1 + 2 + ... + d: count the cells, keep those with a
+                // well cell below them, repeat. Runs are short, so this stops after a few rounds.
+                while (anyWell) {
+                    anyWell = 0;
+                    for (int k = WORDS - 1; k >= 0; --k) {
+                        wellSums += std::popcount(wells[k]);
+                        wells[k] &= (wells[k] << 16) | (k > 0 ? wells[k - 1] >> 48 : 0);
+                        anyWell |= wells[k];
+                    }
+                }
+                f.rowTransitions = rowT;
+                f.colTransitions = colT;
+            }
+            else {
+                int top = 0;
+                for (int x = 0; x < W; ++x) top = g.heights[x] > top ? g.heights[x] : top;
+                constexpr int PLANES = std::bit_width((unsigned)H);
+                Row run[PLANES] = {};
+                Row running = 0;
+                auto addWells = [&](Row well) {
+                    if (!(well | running)) return; // most rows: no well cells, no runs to end
+                    running = well;
+                    Row carry = well;
+                    for (int b = 0; b < PLANES; ++b) {
+                        Row t = run[b] & well;
+                        run[b] = t ^ carry;
+                        carry = t & carry;
+                        wellSums += std::popcount(run[b]) << b;
+                    }
+                };
+                Row below = FULL, emptyBelow = 0;
+                Row seen[H + 1];
+                seen[top] = 0;
+                for (int y = top - 1; y >= 0; --y) seen[y] = seen[y + 1] | g.row(y);
+                for (int y = 0; y < top; ++y) {
+                    Row r = g.row(y);
+                    Row inner = (Row)(r ^ (r >> 1)) & (Row)(FULL >> 1);
+                    rowT += std::popcount(inner) + !(r & LEFT_WALL) + !(r & RIGHT_WALL);
+                    colT += std::popcount((Row)(r ^ below));
+                    covered += std::popcount((Row)(r & emptyBelow));
+                    emptyBelow |= (Row)(~r & FULL);
+                    below = r;
+                    Row open = (Row)(~seen[y] & FULL);
+                    addWells(open & (Row)((r << 1) | LEFT_WALL) & (Row)((r >> 1) | RIGHT_WALL));
+                }
+                if (top < H) colT += std::popcount(below);
+                // Above the stack: empty rows with walls either side, and no wells (W >= 4)
+                f.rowTransitions = rowT + 2 * (H - top);
+                f.colTransitions = colT;
+            }
+            f.coveredCells = covered;
+            f.wellSums = wellSums;
+        }
+
+        // One H-bit mask per column: bit y of cols[x] is cell (x, y)
+        template <int W, int H>
+        void transpose(const game::BasicGame<W, H>& g, ColumnBits<H>* cols) {
+            using Row = typename game::BasicGame<W, H>::Row;
+            using Col = ColumnBits<H>;
+            static_assert(H <= 64, "columns are stored in at most 64 bits");
+            for (int x = 0; x < W; ++x) cols[x] = 0;
+#if defined(TETRIS_HAS_PEXT)
+            if constexpr (sizeof(Row) <= 2) {
+                // Pack 64 / ROW_BITS rows per word; bit x of each lane is one cell of column x
+                constexpr int ROW_BITS = 8 * (int)sizeof(Row), LANES = 64 / ROW_BITS;
+                constexpr std::uint64_t LANE_LOW = ROW_BITS == 8 ? 0x0101010101010101ull : 0x0001000100010001ull;
+                for (int y = 0; y < H; y += LANES) {
+                    std::uint64_t packed = 0;
+                    for (int i = 0; i < LANES && y + i < H; ++i) packed |= (std::uint64_t)g.row(y + i) << (i * ROW_BITS);
+                    if (!packed) continue;
+                    for (int x = 0; x < W; ++x) cols[x] |= (Col)((Col)_pext_u64(packed, LANE_LOW << x) << y);
+                }
+                return;
+            }
+#endif
+            for (int y = 0; y < H; ++y) {
+                for (Row r = g.row(y); r; r &= (Row)(r - 1)) cols[std::countr_zero(r)] |= (Col)((Col)1 << y);
+            }
+        }
+
+        // Every feature but lines from the transposed board
+        template <int W, int H>
+        void fromColumns(const ColumnBits<H>* cols, Features& f) {
+            using Col = ColumnBits<H>;
+            constexpr Col ALL = (Col)(H == 8 * sizeof(Col) ? ~Col(0) : (Col(1) << H) - 1);
+            int heights[W];
+            int holes = 0, covered = 0, colT = 0, rowT = 0, wellSums = 0;
+            for (int x = 0; x < W; ++x) {
+                Col c = cols[x];
+                int h = std::bit_width(c);
+                Col underSurface = (Col)(h == 8 * (int)sizeof(Col) ? ~Col(0) : (Col(1) << h) - 1);
+                heights[x] = h;
+                holes += h - std::popcount(c);
+                Col gaps = (Col)(~c & underSurface);
+                if (gaps) covered += std::popcount((Col)(c >> std::countr_zero(gaps)));
+                colT += std::popcount((Col)((c ^ (Col)((c << 1) | 1)) & ALL));
+                rowT += std::popcount((Col)(c ^ (x > 0 ? cols[x - 1] : ALL)));
+
+                Col l = x > 0 ? cols[x - 1] : ALL, r = x < W - 1 ? cols[x + 1] : ALL;
+                // A run of d well cells adds 1 + 2 + ... + d: one popcount per run length
+                for (Col m = (Col)(l & r & ~underSurface & ALL); m; m &= (Col)(m >> 1)) wellSums += std::popcount(m);
+            }
+            rowT += std::popcount((Col)(~cols[W - 1] & ALL));
+            fromHeights<W, H>(heights, f);
+            f.holes = holes;
+            f.coveredCells = covered;
+            f.rowTransitions = rowT;
+            f.colTransitions = colT;
+            f.wellSums = wellSums;
+        }
+
+    } // namespace kernels
+
+} // namespace ai
@@ -0,0 +1,128 @@
+#include "Player.h"
+#include "../game/Simulation.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace ai {
+
+    using game::BOARD_W;
+    using game::BOARD_H;
+
+    Features Measure(const game::Game& g, int lines, bool scan) {
+        Features f{};
+        kernels::fromHeights<BOARD_W, BOARD_H>(g.heights, f);
+        if (scan) kernels::fromRows(g, f);
+        f.holes = g.holes;
+        f.lines = lines;
+        return f;
+    }
+
+    bool SaveWeights(const char* path, const Weights& w, const char* comment) {
+        std::FILE* f = std::fopen(path, "w");
+        if (!f) { std::fprintf(stderr, "[Weights] cannot write: %s\n", path); return false; }
+        if (comment) std::fprintf(f, "# %s\n", comment);
+        for (const WeightField& wf : WEIGHT_FIELDS) std::fprintf(f, "%s = %.9g\n", wf.name, w.*wf.field);
+        bool ok = std::fclose(f) == 0;
+        if (!ok) std::fprintf(stderr, "[Weights] write fail: %s\n", path);
+        return ok;
+    }
+
+    bool LoadWeights(const char* path, Weights& w) {
+        std::FILE* f = std::fopen(path, "r");
+        if (!f) { std::fprintf(stderr, "[Weights] cannot open: %s\n", path); return false; }
+        Weights loaded;
+        bool ok = true;
+        char line[256];
+        for (int n = 1; ok && std::fgets(line, sizeof line, f); ++n) {
+            char name[64];
+            float value;
+            char* p = line + std::strspn(line, " \t");
+            if (*p == '#' || *p == '\n' || *p == '\r' || *p == 0) continue;
+            if (std::sscanf(p, "%63[A-Za-z] = %f", name, &value) != 2) {
+                std::fprintf(stderr, "[Weights] %s:%d: expected name = value\n", path, n); ok = false; break;
+            }
+            const WeightField* wf = std::find_if(std::begin(WEIGHT_FIELDS), std::end(WEIGHT_FIELDS),
+                [&](const WeightField& x) { return std::strcmp(x.name, name) == 0; });
+            if (wf == std::end(WEIGHT_FIELDS)) { std::fprintf(stderr, "[Weights] %s:%d: unknown weight %s\n", path, n, name); ok = false; }
+            else loaded.*wf->field = value;
+        }
+        std::fclose(f);
+        if (ok) w = loaded;
+        return ok;
+    }
+
+    const Plan& Player::Think(const game::Game& g) {
+        m_Plan.valid = false;
+        m_Plan.moveCount = 0;
+        if (g.gameOver) return m_Plan;
+
+        game::GeneratePlacements(g, g.cur.type, m_List);
+        game::Save(g, m_Root);
+        bool scan = UsesRowScan(m_Weights);
+        int best = -1;
+        for (int k = 0; k < m_List.count; ++k) {
+            game::Active a = m_List[k];
+            const auto& pm = game::PIECE_MASKS<BOARD_W>[a.type][a.r][game::MASK_X_BIAS];
+            if (a.y + pm.maxY >= BOARD_H) continue; // cells above the ceiling would be lost
+            game::Restore(m_Scratch, m_Root);
+            m_Scratch.cur = a;
+            game::lockPiece(m_Scratch);
+            int lines = game::clearLines(m_Scratch);
+            float s = Evaluate(m_Weights, Measure(m_Scratch, lines, scan));
+            if (best < 0 || s > m_Plan.score) { best = k; m_Plan.score = s; }
+        }
+        if (best < 0) return m_Plan;
+
+        m_Plan.valid = true;
+        m_Plan.target = m_List[best];
+        m_Plan.moveCount = std::min(m_List.Path(best, m_Plan.moves, Plan::MAX_MOVES, m_Plan.after), Plan::MAX_MOVES);
+        return m_Plan;
+    }
+
+    bool Planner::PlayPiece(game::Game& g) {
+        const Plan& p = Think(g);
+        if (!p.valid) { g.gameOver = true; return false; }
+        g.cur = p.target;
+        game::lockPiece(g);
+        game::clearLines(g);
+        game::spawn(g);
+        return !g.gameOver;
+    }
+
+    std::uint8_t Driver::Next(const game::Game& g) {
+        using namespace game;
+        if (g.gameOver || g.paused) { m_Last = 0; return 0; }
+        if (!m_Planned || m_Head != g.bag.queueHead) {
+            m_Plan = m_Planner->Think(g);
+            m_Planned = true; m_Head = g.bag.queueHead;
+            m_Step = 0; m_StepTicks = 0;
+            if (!m_Plan.valid) m_Plan.moveCount = 0; // nowhere good to go: drop where it is
+        }
+
+        // Skip the moves the piece has already made (gravity may have done a soft drop's job)
+        auto reached = [&](int k) {
+            const Active& e = m_Plan.after[k];
+            if (g.cur.x != e.x || g.cur.r != e.r) return false;
+            return m_Plan.moves[k] != Move::SoftDrop || g.cur.y <= e.y;
+        };
+        while (m_Step < m_Plan.moveCount && reached(m_Step)) { ++m_Step; m_StepTicks = 0; }
+        if (m_Step < m_Plan.moveCount && ++m_StepTicks > TICK_HZ / 2) m_Step = m_Plan.moveCount;
+
+        std::uint8_t button = INPUT_HARD_DROP;
+        if (m_Step < m_Plan.moveCount) {
+            switch (m_Plan.moves[m_Step]) {
+            case Move::Left: button = INPUT_LEFT; break;
+            case Move::Right: button = INPUT_RIGHT; break;
+            case Move::RotateCW: button = INPUT_ROTATE_CW; break;
+            case Move::RotateCCW: button = INPUT_ROTATE_CCW; break;
+            case Move::SoftDrop: m_Last = INPUT_SOFT_DROP; return m_Last; // held, not tapped
+            }
+        }
+        // Everything else triggers on the press edge: release for a tick between taps
+        m_Last = (m_Last & button) ? 0 : button;
+        return m_Last;
+    }
+
+} // namespace ai
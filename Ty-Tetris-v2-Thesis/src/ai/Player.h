@@ -0,0 +1,120 @@
+#pragma once
+#include "Features.h"
+#include "../game/MoveGen.h"
+#include "../game/Snapshot.h"
+#include <cstdint>
+#include <iterator>
+
+namespace ai {
+
+    // A placement scores the weighted sum of its features; higher is better
+    struct Weights {
+        float aggregateHeight = -0.51f;
+        float holes = -0.36f;
+        float bumpiness = -0.18f;
+        float wells = -0.08f;
+        float lines = 0.76f;
+        float coveredCells = 0.0f; // the board-scan features are off until tuned
+        float rowTransitions = 0.0f;
+        float colTransitions = 0.0f;
+        float wellSums = 0.0f;
+    };
+
+    // Named weights, in file order, for configs and tuners that treat them as a vector
+    struct WeightField { const char* name; float Weights::* field; };
+    inline constexpr WeightField WEIGHT_FIELDS[] = {
+        { "aggregateHeight", &Weights::aggregateHeight },
+        { "holes", &Weights::holes },
+        { "bumpiness", &Weights::bumpiness },
+        { "wells", &Weights::wells },
+        { "lines", &Weights::lines },
+        { "coveredCells", &Weights::coveredCells },
+        { "rowTransitions", &Weights::rowTransitions },
+        { "colTransitions", &Weights::colTransitions },
+        { "wellSums", &Weights::wellSums },
+    };
+    inline constexpr int WEIGHT_COUNT = (int)std::size(WEIGHT_FIELDS);
+
+    // Plain text config, one "name = value" per line, '#' comments. Loading starts from the
+    // defaults, so a file may set only some weights; unknown names are an error.
+    bool SaveWeights(const char* path, const Weights& w, const char* comment = nullptr);
+    bool LoadWeights(const char* path, Weights& w);
+
+    // True when a weight is set on one of the features that need a scan of the rows
+    inline bool UsesRowScan(const Weights& w) {
+        return w.coveredCells != 0 || w.rowTransitions != 0 || w.colTransitions != 0 || w.wellSums != 0;
+    }
+
+    // Everything but the row-scan features comes from the metrics the game keeps; without
+    // `scan` those are left at zero.
+    Features Measure(const game::Game& g, int lines, bool scan = true);
+
+    inline float Evaluate(const Weights& w, const Features& f) {
+        return w.aggregateHeight * f.aggregateHeight + w.holes * f.holes + w.bumpiness * f.bumpiness
+            + w.wells * f.wells + w.lines * f.lines + w.coveredCells * f.coveredCells
+            + w.rowTransitions * f.rowTransitions + w.colTransitions * f.colTransitions + w.wellSums * f.wellSums;
+    }
+
+    // The placement picked for the active piece and the inputs that reach it from spawn
+    struct Plan {
+        static constexpr int MAX_MOVES = 64;
+        bool valid = false; // false: no placement keeps the piece on the board
+        game::Active target{};
+        float score = 0.0f;
+        game::Move moves[MAX_MOVES];
+        game::Active after[MAX_MOVES]; // the piece after each move
+        int moveCount = 0;
+    };
+
+    // Anything that picks a placement for the active piece of a game
+    class Planner {
+    public:
+        virtual ~Planner() = default;
+
+        virtual const Plan& Think(const game::Game& g) = 0;
+
+        // Think, then lock the chosen placement, clear lines and spawn the next piece.
+        // Returns false (and sets gameOver) when the game is lost.
+        bool PlayPiece(game::Game& g);
+    };
+
+    // Greedy one-piece bot: tries every reachable placement of the active piece on a scratch
+    // copy and keeps the best-scoring one. No allocation after construction.
+    class Player : public Planner {
+    public:
+        explicit Player(const Weights& w = {}) : m_Weights(w) {}
+
+        const Plan& Think(const game::Game& g) override;
+
+        const Weights& GetWeights() const { return m_Weights; }
+        void SetWeights(const Weights& w) { m_Weights = w; }
+
+    private:
+        Weights m_Weights;
+        Plan m_Plan;
+        game::GameSnapshot m_Root;
+        game::Game m_Scratch;
+        game::PlacementList<game::BOARD_W, game::BOARD_H> m_List;
+    };
+
+    // Turns plans into the buttons a real-time Simulation is fed each tick: moves of the path
+    // are tapped (rotations and shifts trigger on press), soft drops held until the piece is
+    // low enough, then the piece is hard dropped. Each new piece gets a new plan; a move that
+    // does not take effect in time (e.g. gravity got there first) ends the path early.
+    class Driver {
+    public:
+        explicit Driver(Planner& p) : m_Planner(&p) {}
+
+        std::uint8_t Next(const game::Game& g);
+        void Reset() { m_Planned = false; m_Last = 0; }
+
+    private:
+        Planner* m_Planner;
+        Plan m_Plan;
+        bool m_Planned = false;
+        int m_Head = 0;          // bag queue head when planned: it moves on every spawn
+        int m_Step = 0, m_StepTicks = 0;
+        std::uint8_t m_Last = 0; // buttons of the previous tick
+    };
+
+} // namespace ai
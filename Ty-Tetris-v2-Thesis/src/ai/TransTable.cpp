@@ -0,0 +1,116 @@
+#include "TransTable.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <new>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace ai {
+
+    namespace {
+        constexpr std::uint64_t USED = 1ull << 48;
+
+        std::uint64_t pack(float value, int depth, std::uint32_t generation) {
+            return std::bit_cast<std::uint32_t>(value) | (std::uint64_t)(depth & 0xFF) << 32
+                | (std::uint64_t)generation << 40 | USED;
+        }
+        int depthOf(std::uint64_t d) { return (int)(d >> 32 & 0xFF); }
+        std::uint32_t generationOf(std::uint64_t d) { return (std::uint32_t)(d >> 40 & 0xFF); }
+
+        // Large pages first, plain pages (with a transparent huge page hint) otherwise
+        void* allocate(std::size_t bytes, bool& huge) {
+            huge = false;
+#if defined(_WIN32)
+            SIZE_T large = GetLargePageMinimum();
+            if (large && bytes % large == 0) {
+                if (void* p = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE)) {
+                    huge = true;
+                    return p;
+                }
+            }
+            return VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#elif defined(__linux__)
+            void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED) { huge = true; return p; }
+            p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) return nullptr;
+#ifdef MADV_HUGEPAGE
+            huge = madvise(p, bytes, MADV_HUGEPAGE) == 0;
+#endif
+            return p;
+#else
+            return ::operator new(bytes, std::align_val_t{ 64 }, std::nothrow);
+#endif
+        }
+
+        void release(void* p, std::size_t bytes) {
+            if (!p) return;
+#if defined(_WIN32)
+            (void)bytes;
+            VirtualFree(p, 0, MEM_RELEASE);
+#elif defined(__linux__)
+            munmap(p, bytes);
+#else
+            (void)bytes;
+            ::operator delete(p, std::align_val_t{ 64 });
+#endif
+        }
+    }
+
+    TransTable::TransTable(std::size_t megabytes) {
+        // Power-of-two bucket count, at least one 2 MB huge page
+        std::size_t bytes = std::bit_floor(std::max<std::size_t>(megabytes, 2) << 20);
+        void* p = allocate(bytes, m_HugePages);
+        if (!p) throw std::bad_alloc();
+        m_Buckets = static_cast<Bucket*>(p);
+        m_Bytes = bytes;
+        m_Mask = bytes / sizeof(Bucket) - 1;
+        Clear();
+    }
+
+    TransTable::~TransTable() { release(m_Buckets, m_Bytes); }
+
+    // Not safe while searches are running
+    void TransTable::Clear() {
+        std::memset(static_cast<void*>(m_Buckets), 0, m_Bytes);
+        m_Generation = 1;
+    }
+
+    bool TransTable::Probe(std::uint64_t key, int depth, float& value) const {
+        const Bucket& b = m_Buckets[key & m_Mask];
+        for (const Slot& s : b.slots) {
+            std::uint64_t d = s.data.load(std::memory_order_relaxed);
+            std::uint64_t c = s.check.load(std::memory_order_relaxed);
+            if ((c ^ d) != key || !(d & USED) || depthOf(d) != depth) continue;
+            value = std::bit_cast<float>((std::uint32_t)d);
+            return true;
+        }
+        return false;
+    }
+
+    // Replace the same position, else an empty slot, else the entry from the oldest search
+    // that is cheapest to recompute (the shallowest)
+    void TransTable::Store(std::uint64_t key, int depth, float value) {
+        Bucket& b = m_Buckets[key & m_Mask];
+        Slot* victim = nullptr;
+        int victimCost = 0;
+        for (Slot& s : b.slots) {
+            std::uint64_t d = s.data.load(std::memory_order_relaxed);
+            if (!(d & USED)) { victim = &s; break; }
+            if ((s.check.load(std::memory_order_relaxed) ^ d) == key && depthOf(d) == depth) { victim = &s; break; }
+            int cost = depthOf(d) + (generationOf(d) == m_Generation ? 256 : 0);
+            if (!victim || cost < victimCost) { victim = &s; victimCost = cost; }
+        }
+        std::uint64_t d = pack(value, depth, m_Generation);
+        victim->check.store(key ^ d, std::memory_order_relaxed);
+        victim->data.store(d, std::memory_order_relaxed);
+    }
+
+} // namespace ai
@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ai {
+
+    // Fixed-size transposition table shared by every search thread without locks. Entries are
+    // two words, the key stored XORed with the data (Hyatt's lockless hashing): a slot torn by
+    // a concurrent write fails the key check and reads as a miss, never as a wrong value.
+    // Buckets of four slots fill one cache line. The memory is asked for in huge pages where
+    // the OS allows it, since probes land at random across the whole table.
+    class TransTable {
+    public:
+        explicit TransTable(std::size_t megabytes);
+        ~TransTable();
+        TransTable(const TransTable&) = delete;
+        TransTable& operator=(const TransTable&) = delete;
+
+        // Value stored for `key` searched `depth` pieces deep
+        bool Probe(std::uint64_t key, int depth, float& value) const;
+        void Store(std::uint64_t key, int depth, float value);
+
+        void NewSearch() { m_Generation = (m_Generation + 1) & 0xFF; } // older entries go first
+        void Clear();
+
+        std::size_t Bytes() const { return m_Bytes; }
+        bool HugePages() const { return m_HugePages; }
+
+    private:
+        struct Slot {
+            std::atomic<std::uint64_t> check; // key ^ data
+            std::atomic<std::uint64_t> data;  // value bits | depth << 32 | generation << 40 | used << 48; 0 when empty
+        };
+        struct alignas(64) Bucket { Slot slots[4]; };
+
+        Bucket* m_Buckets = nullptr;
+        std::size_t m_Mask = 0; // bucket count - 1
+        std::size_t m_Bytes = 0;
+        bool m_HugePages = false;
+        std::uint32_t m_Generation = 1;
+    };
+
+} // namespace ai
@@ -15,13 +15,46 @@
 #include "../engine/Texture.h"
 #include "../engine/Audio.h"
 #include "../engine/DB.h"
+#include "../engine/InputQueue.h"
+#include "../ai/Player.h"
 #include "../game/Tetris.h"
+#include "../game/Simulation.h"
+#include "../game/Replay.h"
+#include "../game/Render.h"
 #include "../game/UI.h"
 
 #include "stb_image.h" // declarations only (implementation in Texture.cpp)
 
+#include <algorithm>
 #include <chrono>
-#include <cmath>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <cstdint>
+#include <random>
+
+static std::int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Runs inside glfwPollEvents; stamps the event and hands it to the game loop
+static void OnKey(GLFWwindow* win, int key, int /*scancode*/, int action, int /*mods*/) {
+    if (action == GLFW_REPEAT) return; // auto-repeat is the simulation's job (DAS/ARR)
+    auto* queue = static_cast<eng::InputQueue*>(glfwGetWindowUserPointer(win));
+    queue->Push({ NowNs(), key, action == GLFW_PRESS });
+}
+
+static std::uint8_t ButtonForKey(int key) {
+    switch (key) {
+    case GLFW_KEY_LEFT: return game::INPUT_LEFT;
+    case GLFW_KEY_RIGHT: return game::INPUT_RIGHT;
+    case GLFW_KEY_UP: case GLFW_KEY_X: return game::INPUT_ROTATE_CW;
+    case GLFW_KEY_Z: return game::INPUT_ROTATE_CCW;
+    case GLFW_KEY_DOWN: return game::INPUT_SOFT_DROP;
+    case GLFW_KEY_SPACE: return game::INPUT_HARD_DROP;
+    default: return 0;
+    }
+}
 
 static void ApplyRetroTheme() {
     ImGuiStyle& s = ImGui::GetStyle();
@@ -36,7 +69,19 @@ static void ApplyRetroTheme() {
     c[ImGuiCol_ButtonActive] = ImVec4(0.20f, 0.80f, 1.00f, 1.0f);
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // --replay <file>: watch a recorded game instead of playing
+    // --autoplay: the bot plays (F1 toggles it during a game)
+    // --weights <file>: evaluation weights for the bot (e.g. from tetris_tune)
+    game::Replay replay;
+    ai::Weights botWeights;
+    bool haveReplay = false, autoplay = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) haveReplay = game::LoadReplay(argv[++i], replay);
+        else if (std::strcmp(argv[i], "--autoplay") == 0) autoplay = true;
+        else if (std::strcmp(argv[i], "--weights") == 0 && i + 1 < argc) ai::LoadWeights(argv[++i], botWeights);
+    }
+
     if (!glfwInit()) return 1;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -54,6 +99,11 @@ int main() {
         if (pixels) { images[0].width = w; images[0].height = h; images[0].pixels = pixels; glfwSetWindowIcon(win, 1, images); stbi_image_free(pixels); }
     }
 
+    // Keyboard events; installed before ImGui so its GLFW backend chains to our callback
+    eng::InputQueue keyQueue;
+    glfwSetWindowUserPointer(win, &keyQueue);
+    glfwSetKeyCallback(win, OnKey);
+
     // ImGui
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -69,43 +119,69 @@ int main() {
     eng::DB    db;    db.Open("tetris.db");
 
     // Game state
-    game::Game g; g.bag.refill(5);
-    auto last = std::chrono::high_resolution_clock::now();
-    double accSec = 0.0;
+    game::Game g; g.bag.refill(game::PREVIEW_COUNT);
+    game::Simulation sim{ g };
+    std::random_device seeder;
+    // Time in units of 1 / (1e9 * TICK_HZ) s, so one tick is exactly 1e9 of them and event
+    // timestamps map onto tick boundaries without rounding. simUnits is the end of the last tick.
+    // Counted from startup: steady_clock's epoch can be far enough back for ns * TICK_HZ to overflow.
+    const std::int64_t TICK_UNITS = 1'000'000'000;
+    const std::int64_t startNs = NowNs();
+    auto toUnits = [startNs](std::int64_t ns) { return (ns - startNs) * game::TICK_HZ; };
+    std::int64_t simUnits = toUnits(NowNs());
+    std::uint8_t held = 0; // buttons down as of simUnits
+    const std::int64_t MAX_BACKLOG = TICK_UNITS * game::TICK_HZ / 4; // drop time after a stall (> 250 ms)
+    game::ReplayRecorder recorder;
+    std::optional<game::ReplayPlayer> player; // set while watching a replay
+    auto bot = std::make_unique<ai::Player>(botWeights);
+    ai::Driver botDriver{ *bot };
 
     auto resetToStart = [&]() {
-        bool keepMusic = g.musicOn;
+        bool keepMusic = g.musicOn, keep20G = g.instantGravity;
         g = game::Game{};
         g.musicOn = keepMusic;
-        g.bag.refill(5);
+        g.instantGravity = keep20G;
+        g.bag.refill(game::PREVIEW_COUNT);
         audio.StopMusic();
         g.scene = game::Scene::Start;
         };
     auto startWithLevel = [&](int idx) {
-        bool keepMusic = g.musicOn;
+        bool keepMusic = g.musicOn, keep20G = g.instantGravity;
         g = game::Game{};
         g.musicOn = keepMusic;
+        g.instantGravity = keep20G;
         g.levelIndex = idx;
         g.level = 1 + (idx == 0 ? 0 : (idx == 1 ? 4 : 9));
         g.scene = game::Scene::Playing;
-        g.bag.refill(5);
-        game::SeedObstructions(g, idx);
-        game::spawn(g);
-        accSec = 0.0;
+        std::uint64_t seed = ((std::uint64_t)seeder() << 32) | seeder();
+        sim.Start(seed);
+        recorder.Begin(seed, g);
+        player.reset();
+        botDriver.Reset();
+        simUnits = toUnits(NowNs());
+        held = 0;
         audio.SetMusicOn(g.musicOn);
         audio.PlayMusic("resources/music/theme.wav", true);
         };
     auto onMusicToggle = [&](bool on)->bool { audio.SetMusicOn(on); return on; };
     auto getTopScores = [&]() { return db.Top(10); };
 
+    if (haveReplay) {
+        bool keepMusic = g.musicOn;
+        game::StartReplay(replay, g, sim);
+        g.musicOn = keepMusic;
+        g.scene = game::Scene::Playing;
+        player.emplace(replay);
+        audio.SetMusicOn(g.musicOn);
+        audio.PlayMusic("resources/music/theme.wav", true);
+    }
+
     while (!glfwWindowShouldClose(win)) {
         glfwPollEvents();
 
-        // timing
-        auto now = std::chrono::high_resolution_clock::now();
-        int deltaMs = (int)std::chrono::duration_cast<std::chrono::milliseconds>(now - last).count();
-        double dt = deltaMs / 1000.0;
-        last = now;
+        std::int64_t nowUnits = toUnits(NowNs());
+        if (g.scene != game::Scene::Playing) // menu keystrokes never reach a game
+            for (eng::KeyEvent e; keyQueue.Peek(e); keyQueue.Pop()) {}
 
         int fbw, fbh; glfwGetFramebufferSize(win, &fbw, &fbh);
         glViewport(0, 0, fbw, fbh);
@@ -137,34 +213,46 @@ int main() {
         }
 
         if (g.scene == Scene::Playing) {
-            // inputs (only if ImGui isn't typing)
-            if (!ImGui::GetIO().WantCaptureKeyboard) {
-                if (glfwGetKey(win, GLFW_KEY_P) == GLFW_PRESS) g.paused = true;
-                if (glfwGetKey(win, GLFW_KEY_ESCAPE) == GLFW_PRESS) g.paused = !g.paused;
-
-                if (!g.paused && !g.gameOver) {
-                    if (glfwGetKey(win, GLFW_KEY_LEFT) == GLFW_PRESS) game::tryMove(g, -1, 0);
-                    if (glfwGetKey(win, GLFW_KEY_RIGHT) == GLFW_PRESS) game::tryMove(g, +1, 0);
-                    if (glfwGetKey(win, GLFW_KEY_UP) == GLFW_PRESS || glfwGetKey(win, GLFW_KEY_X) == GLFW_PRESS) game::rotate(g, +1);
-                    if (glfwGetKey(win, GLFW_KEY_Z) == GLFW_PRESS) game::rotate(g, -1);
-                    if (glfwGetKey(win, GLFW_KEY_SPACE) == GLFW_PRESS) { game::hardDrop(g); game::lockPiece(g); game::clearLines(g); game::spawn(g); }
+            // Key events up to the end of each tick are applied right before that tick is
+            // stepped. A press released within the same tick is kept down for one tick.
+            bool typing = ImGui::GetIO().WantCaptureKeyboard;
+            auto applyEventsUntil = [&](std::int64_t endUnits) {
+                std::uint8_t pressed = 0;
+                for (eng::KeyEvent e; keyQueue.Peek(e) && toUnits(e.timeNs) < endUnits; keyQueue.Pop()) {
+                    if (typing) continue;
+                    if (e.action && e.key == GLFW_KEY_P) g.paused = true;
+                    if (e.action && e.key == GLFW_KEY_ESCAPE) g.paused = !g.paused;
+                    if (e.action && e.key == GLFW_KEY_F1) { autoplay = !autoplay; botDriver.Reset(); }
+                    std::uint8_t b = ButtonForKey(e.key);
+                    if (!e.action && (pressed & b)) break;
+                    if (e.action) { held |= b; pressed |= b; }
+                    else held &= (std::uint8_t)~b;
                 }
-            }
-
-            double base = 1.0 / std::pow(1.25, g.level - 1);
-            if (g.levelIndex == 1) base *= 0.6; else if (g.levelIndex == 2) base *= 0.35;
-            double speed = (glfwGetKey(win, GLFW_KEY_DOWN) == GLFW_PRESS) ? 0.05 : base;
+            };
 
-            if (!g.paused && !g.gameOver) {
-                accSec += dt;
-                game::MaybeAddGarbage(g, deltaMs);
-                while (accSec >= speed) {
-                    if (!game::tryMove(g, 0, -1)) { game::lockPiece(g); game::clearLines(g); game::spawn(g); }
-                    accSec -= speed;
+            if (g.paused || g.gameOver) {
+                applyEventsUntil(nowUnits);
+                simUnits = nowUnits; // paused time is not simulated
+            }
+            else {
+                simUnits = std::max(simUnits, nowUnits - MAX_BACKLOG);
+                for (; simUnits + TICK_UNITS <= nowUnits && !g.paused && !g.gameOver; simUnits += TICK_UNITS) {
+                    applyEventsUntil(simUnits + TICK_UNITS);
+                    if (g.paused) break;
+                    std::uint8_t inputs = held;
+                    if (player) {
+                        if (player->Done()) { g.gameOver = true; break; } // end of the recording
+                        inputs = player->Next();
+                    }
+                    else {
+                        if (autoplay) inputs = botDriver.Next(g);
+                        recorder.Record((std::uint32_t)sim.Tick(), inputs);
+                    }
+                    sim.Step(inputs);
                 }
             }
 
-            game::DrawGrid(renderer);
+            game::DrawGrid<game::BOARD_W, game::BOARD_H>(renderer);
             game::DrawBoard(renderer, g);
             if (!g.gameOver) game::DrawActive(renderer, g);
 
@@ -185,7 +273,11 @@ int main() {
 
             if (g.gameOver) {
                 audio.StopMusic();
-                db.InsertScore(g.playerName.empty() ? "Player" : g.playerName, g.score, g.level);
+                if (!player) {
+                    db.InsertScore(g.playerName.empty() ? "Player" : g.playerName, g.score, g.level);
+                    recorder.Finish((std::uint32_t)sim.Tick(), g);
+                    game::SaveReplay("last_game.trp", recorder.Get());
+                }
                 g.scene = Scene::GameOver;
             }
         }
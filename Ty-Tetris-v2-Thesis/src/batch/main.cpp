@@ -0,0 +1,241 @@
+// Headless batch simulator: plays N seeded games with a bot policy on every core, one worker
+// thread per core pinned in place, and reports throughput plus score, line and per-piece cost
+// distributions. Game n always uses seed + n and the results are gathered by game index, so
+// the summary (and its checksum) is the same for any thread count: run it before and after a
+// rules or AI change and compare.
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "../ai/BeamSearch.h"
+#include "../ai/Expectimax.h"
+#include "../game/Simulation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    enum class Policy { Greedy, Beam, Expectimax };
+
+    struct Options {
+        int games = 1000, maxPieces = 10'000, threads = 0, levelIndex = 0;
+        std::uint64_t seed = 1;
+        bool sim = false, pin = true;
+        Policy policy = Policy::Greedy;
+        ai::Weights weights;
+        int width = 64, depth = 3;
+    };
+
+    struct GameResult { int pieces, lines, score; bool toppedOut; };
+
+    // Per-piece cost in nanoseconds, log-bucketed: 8 buckets per power of two (12% wide)
+    struct CostHistogram {
+        static constexpr int SUB = 8, BUCKETS = 8 + 60 * SUB;
+        std::uint64_t counts[BUCKETS] = {};
+
+        static int bucket(std::uint64_t ns) {
+            if (ns < 8) return (int)ns;
+            int e = std::bit_width(ns) - 1; // >= 3
+            return 8 + (e - 3) * SUB + (int)((ns >> (e - 3)) & (SUB - 1));
+        }
+        static std::uint64_t lower(int b) {
+            if (b < 8) return (std::uint64_t)b;
+            int e = (b - 8) / SUB + 3;
+            return (std::uint64_t)(SUB + (b - 8) % SUB) << (e - 3);
+        }
+        void add(std::uint64_t ns) { ++counts[std::min(bucket(ns), BUCKETS - 1)]; }
+        void merge(const CostHistogram& o) { for (int i = 0; i < BUCKETS; ++i) counts[i] += o.counts[i]; }
+        std::uint64_t percentile(double p) const {
+            std::uint64_t total = 0;
+            for (auto c : counts) total += c;
+            std::uint64_t want = (std::uint64_t)(p * (double)total), seen = 0;
+            for (int i = 0; i < BUCKETS; ++i) if ((seen += counts[i]) > want) return lower(i);
+            return lower(BUCKETS - 1);
+        }
+    };
+
+    // Everything one thread touches while playing, on cache lines of its own
+    struct alignas(64) Worker {
+        game::Game g;
+        std::unique_ptr<ai::Planner> player;
+        CostHistogram cost;
+        std::uint64_t pieces = 0;
+        bool pinned = false;
+        std::vector<std::pair<int, GameResult>> results; // (game index, result); put in game order after the run
+    };
+
+    std::unique_ptr<ai::Planner> MakePlayer(const Options& o) {
+        switch (o.policy) {
+        case Policy::Beam: return std::make_unique<ai::BeamSearch>(ai::SearchParams{ o.width, o.depth, 1 }, o.weights);
+        case Policy::Expectimax: return std::make_unique<ai::Expectimax>(ai::ExpectimaxParams{ o.depth, 6, 1, 16 }, o.weights);
+        default: return std::make_unique<ai::Player>(o.weights);
+        }
+    }
+
+    // The CPUs this process may run on, in order. Under taskset, cgroups or a job object these
+    // need not be 0 .. n - 1; empty where affinity is not supported.
+    std::vector<int> AllowedCpus() {
+        std::vector<int> cpus;
+#if defined(_WIN32)
+        DWORD_PTR process = 0, system = 0;
+        if (GetProcessAffinityMask(GetCurrentProcess(), &process, &system))
+            for (int c = 0; c < 8 * (int)sizeof(DWORD_PTR); ++c) if ((process >> c) & 1) cpus.push_back(c);
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof set, &set) == 0)
+            for (int c = 0; c < CPU_SETSIZE; ++c) if (CPU_ISSET(c, &set)) cpus.push_back(c);
+#endif
+        return cpus;
+    }
+
+    // False when the OS refused (or affinity is not supported)
+    bool PinToCpu(int cpu) {
+#if defined(_WIN32)
+        return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof set, &set) == 0;
+#else
+        (void)cpu;
+        return false;
+#endif
+    }
+
+    GameResult PlayGame(Worker& w, const Options& o, int n) {
+        using Clock = std::chrono::steady_clock;
+        game::Game& g = w.g;
+        g = game::Game{};
+        g.levelIndex = o.levelIndex;
+        g.level = 1 + (o.levelIndex == 0 ? 0 : (o.levelIndex == 1 ? 4 : 9));
+        game::Simulation s{ g };
+        s.Start(o.seed + n);
+
+        int pieces = 0;
+        auto t0 = Clock::now();
+        if (o.sim) {
+            ai::Driver driver{ *w.player };
+            int head = g.bag.queueHead;
+            while (!g.gameOver && pieces < o.maxPieces) {
+                s.Step(driver.Next(g));
+                if (g.bag.queueHead == head) continue;
+                head = g.bag.queueHead; ++pieces;
+                auto t1 = Clock::now();
+                w.cost.add((std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+                t0 = t1;
+            }
+        }
+        else {
+            while (pieces < o.maxPieces && w.player->PlayPiece(g)) {
+                ++pieces;
+                auto t1 = Clock::now();
+                w.cost.add((std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+                t0 = t1;
+            }
+        }
+        w.pieces += pieces;
+        return { pieces, g.lines, g.score, g.gameOver };
+    }
+
+    template <class F>
+    void PrintDistribution(const char* name, const std::vector<GameResult>& results, F&& field) {
+        std::vector<long long> v;
+        v.reserve(results.size());
+        double sum = 0;
+        for (const GameResult& r : results) { v.push_back(field(r)); sum += (double)v.back(); }
+        std::sort(v.begin(), v.end());
+        auto at = [&](double p) { return v[std::min(v.size() - 1, (std::size_t)(p * (double)v.size()))]; };
+        std::printf("%-8s mean %12.1f  min %10lld  p10 %10lld  p50 %10lld  p90 %10lld  max %10lld\n",
+            name, sum / (double)v.size(), v.front(), at(0.10), at(0.50), at(0.90), v.back());
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--games") == 0 && i + 1 < argc) o.games = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--pieces") == 0 && i + 1 < argc) o.maxPieces = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) o.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) o.threads = std::max(0, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--level") == 0 && i + 1 < argc) o.levelIndex = std::clamp(std::atoi(argv[++i]), 0, 2);
+        else if (std::strcmp(argv[i], "--sim") == 0) o.sim = true;
+        else if (std::strcmp(argv[i], "--no-pin") == 0) o.pin = false;
+        else if (std::strcmp(argv[i], "--beam") == 0 && i + 1 < argc) { o.policy = Policy::Beam; o.width = std::max(1, std::atoi(argv[++i])); }
+        else if (std::strcmp(argv[i], "--expectimax") == 0) o.policy = Policy::Expectimax;
+        else if (std::strcmp(argv[i], "--depth") == 0 && i + 1 < argc) o.depth = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--weights") == 0 && i + 1 < argc) { if (!ai::LoadWeights(argv[++i], o.weights)) return 1; }
+        else {
+            std::fprintf(stderr, "usage: tetris_batch [--games N] [--pieces N] [--seed S] [--threads T] [--level 0-2]\n"
+                "                    [--sim] [--no-pin] [--beam WIDTH | --expectimax] [--depth D] [--weights FILE]\n");
+            return 2;
+        }
+    }
+    int hw = (int)std::max(1u, std::thread::hardware_concurrency());
+    int threads = std::min(o.threads > 0 ? o.threads : hw, o.games);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.push_back(std::make_unique<Worker>());
+        workers.back()->player = MakePlayer(o);
+    }
+    std::atomic<int> next{ 0 };
+    const std::vector<int> cpus = o.pin ? AllowedCpus() : std::vector<int>(); // read before any thread is pinned
+
+    auto t0 = std::chrono::steady_clock::now();
+    auto run = [&](int t) {
+        Worker& w = *workers[t];
+        if (!cpus.empty()) w.pinned = PinToCpu(cpus[t % cpus.size()]); // worker t on the t-th allowed CPU
+        for (int n; (n = next.fetch_add(1, std::memory_order_relaxed)) < o.games;) w.results.emplace_back(n, PlayGame(w, o, n));
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(run, t);
+    run(0);
+    for (std::thread& t : pool) t.join();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::vector<GameResult> results(o.games);
+    CostHistogram cost;
+    std::uint64_t pieces = 0;
+    bool pinned = !cpus.empty();
+    for (const auto& w : workers) {
+        for (const auto& [n, r] : w->results) results[n] = r;
+        cost.merge(w->cost);
+        pieces += w->pieces;
+        pinned = pinned && w->pinned;
+    }
+    int toppedOut = 0;
+    std::uint64_t checksum = 0xCBF29CE484222325ull; // FNV-1a over the results in game order
+    for (const GameResult& r : results) {
+        toppedOut += r.toppedOut;
+        for (long long v : { (long long)r.pieces, (long long)r.lines, (long long)r.score, (long long)r.toppedOut })
+            checksum = (checksum ^ (std::uint64_t)v) * 0x100000001B3ull;
+    }
+
+    std::printf("%d games on %d thread%s%s in %.3f s: %.1f games/s, %.0f pieces/s\n", o.games, threads,
+        threads == 1 ? "" : "s", pinned ? " (pinned)" : "", sec, o.games / sec, pieces / sec);
+    PrintDistribution("score", results, [](const GameResult& r) { return (long long)r.score; });
+    PrintDistribution("lines", results, [](const GameResult& r) { return (long long)r.lines; });
+    PrintDistribution("pieces", results, [](const GameResult& r) { return (long long)r.pieces; });
+    std::printf("per piece p50 %llu ns, p99 %llu ns; %d of %d games topped out; checksum %016llx\n",
+        (unsigned long long)cost.percentile(0.50), (unsigned long long)cost.percentile(0.99), toppedOut, o.games,
+        (unsigned long long)checksum);
+    return 0;
+}
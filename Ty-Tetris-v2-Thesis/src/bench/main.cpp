@@ -0,0 +1,363 @@
+// Headless microbenchmarks for the rules core.
+#include "../game/Tetris.h"
+#include "../game/Placements.h"
+#include "../game/Snapshot.h"
+#include "../game/MoveGen.h"
+#include "../ai/Features.h"
+#include "../ai/BeamSearch.h"
+#include "../ai/Expectimax.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+
+namespace {
+
+    // Results are folded in here so the optimizer cannot drop the timed work
+    volatile int g_Sink = 0;
+
+    // The previous clearLines: shift every row above each full row down by one, then rebuild
+    // the board metrics from scratch (the compacting version keeps them incrementally)
+    template <class G>
+    int clearLinesRowByRow(G& g) {
+        constexpr int H = G::HEIGHT;
+        int cleared = 0;
+        for (int y = 0; y < H; ++y) {
+            if (g.row(y) == G::FULL_ROW) {
+                ++cleared;
+                for (int yy = y; yy < H - 1; ++yy) {
+                    g.row(yy) = g.row(yy + 1);
+                    std::memcpy(g.colorPlanes(yy), g.colorPlanes(yy + 1), sizeof(g.planeSlots[0]));
+                }
+                g.row(H - 1) = 0;
+                std::memset(g.colorPlanes(H - 1), 0, sizeof(g.planeSlots[0]));
+                --y;
+            }
+        }
+        game::recomputeMetrics(g);
+        if (cleared) {
+            static const int T[5] = { 0,100,300,500,800 };
+            g.score += T[cleared] * g.level;
+            g.lines += cleared;
+            int nl = (g.lines / game::LINES_PER_LEVEL) + 1; if (nl > g.level) g.level = nl;
+        }
+        return cleared;
+    }
+
+    // `stack` rows of garbage (one hole each), with `clears` of them filled in completely,
+    // spread evenly through the stack
+    template <class G>
+    void BuildBoard(G& g, int stack, int clears, std::mt19937& rng) {
+        constexpr int W = G::WIDTH;
+        for (int y = 0; y < stack; ++y) {
+            int hole = (int)(rng() % W);
+            for (int x = 0; x < W; ++x) if (x != hole) game::setCell(g, x, y, 1 + (int)(rng() % 7));
+        }
+        for (int i = 0; i < clears; ++i) {
+            int y = (i + 1) * stack / (clears + 1);
+            for (int x = 0; x < W; ++x) if (!((g.row(y) >> x) & 1)) game::setCell(g, x, y, 7);
+        }
+        game::recomputeMetrics(g);
+    }
+
+    template <class G, class F>
+    double NsPerCall(const G& src, G& g, F&& clear, int iters) {
+        int sink = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < iters; ++i) {
+            std::memcpy(g.rowSlots, src.rowSlots, sizeof(g.rowSlots));
+            std::memcpy(g.planeSlots, src.planeSlots, sizeof(g.planeSlots));
+            std::memcpy(g.fillSlots, src.fillSlots, sizeof(g.fillSlots));
+            g.rowBase = src.rowBase;
+            std::memcpy(g.heights, src.heights, sizeof(g.heights));
+            std::memcpy(g.colFill, src.colFill, sizeof(g.colFill));
+            g.holes = src.holes; g.deepestWell = src.deepestWell; g.wellColumn = src.wellColumn;
+            g.boardHash = src.boardHash;
+            sink += clear(g);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        g_Sink = g_Sink + sink;
+        return std::chrono::duration<double, std::nano>(t1 - t0).count() / iters;
+    }
+
+    template <class G>
+    void BenchClearLines(const char* name) {
+        const int iters = 1'000'000;
+        const int stacks[] = { 4, 12, G::HEIGHT - 1 };
+        std::mt19937 rng{ 1337u };
+        std::printf("clearLines on %s %dx%d (ns/call, includes board restore)\n", name, G::WIDTH, G::HEIGHT);
+        std::printf("%6s %6s %12s %12s %8s\n", "stack", "lines", "row-by-row", "compact", "speedup");
+        for (int stack : stacks) {
+            for (int clears = 0; clears <= 4 && clears <= stack; ++clears) {
+                G src, g;
+                BuildBoard(src, stack, clears, rng);
+                double ref = NsPerCall(src, g, clearLinesRowByRow<G>, iters);
+                double cur = NsPerCall(src, g, game::clearLines<G::WIDTH, G::HEIGHT>, iters);
+                std::printf("%6d %6d %12.2f %12.2f %7.2fx\n", stack, clears, ref, cur, ref / cur);
+            }
+        }
+        std::printf("\n");
+    }
+
+    // The previous garbage insertion: copy every row of the board up by one per garbage row
+    template <class G>
+    void pushGarbageByCopy(G& g, int count, int hole) {
+        constexpr int W = G::WIDTH, H = G::HEIGHT;
+        using Row = typename G::Row;
+        for (int i = 0; i < count; ++i) {
+            Row lost = g.row(H - 1);
+            for (int y = H - 1; y > 0; --y) game::detail::copyRow(g, y, y - 1);
+            game::detail::clearRow(g, 0);
+            for (int x = 0; x < W; ++x) if (x != hole) game::setCell(g, x, 0, 5);
+            g.rowFill(0) = (game::Tally<W>)(W - 1);
+            for (int x = 0; x < W; ++x) {
+                if ((lost >> x) & 1) --g.colFill[x];
+                if (x != hole) ++g.colFill[x];
+                int h = g.heights[x];
+                if (h == H) g.heights[x] = (game::Tally<H>)game::detail::surfaceBelow(g, x, H - 1);
+                else if (h || x != hole) g.heights[x] = (game::Tally<H>)(h + 1);
+            }
+        }
+        game::detail::updateHoles(g);
+        game::detail::updateWells(g);
+        g.boardHash = game::detail::rowsHash(g, 0, H);
+    }
+
+    // Garbage stress: every piece is hard-dropped in a random spot, then `perPiece` garbage
+    // rows are pushed under it; the board starts over whenever it tops out
+    template <class G, class F>
+    double GarbageRowsPerSec(F&& push, int perPiece, int pieces) {
+        std::mt19937 rng{ 1337u };
+        static G empty, g;
+        g = empty;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < pieces; ++i) {
+            g.cur = { (int)(rng() % (G::WIDTH - 2)) + 1, G::HEIGHT - 2, (int)(rng() % 4), (int)(rng() % 7) };
+            if (game::collides(g, g.cur)) { g = empty; continue; }
+            game::hardDrop(g);
+            game::lockPiece(g);
+            game::clearLines(g);
+            push(g, perPiece, (int)(rng() % G::WIDTH));
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        g_Sink = g_Sink + g.holes;
+        return (double)pieces * perPiece / std::chrono::duration<double>(t1 - t0).count();
+    }
+
+    template <class G>
+    void BenchGarbage(const char* name, int perPiece) {
+        const int pieces = 200'000;
+        double copy = GarbageRowsPerSec<G>(pushGarbageByCopy<G>, perPiece, pieces);
+        double ring = GarbageRowsPerSec<G>(game::pushGarbage<G::WIDTH, G::HEIGHT>, perPiece, pieces);
+        std::printf("garbage stress on %s %dx%d, %d rows per piece (rows/s)\n", name, G::WIDTH, G::HEIGHT, perPiece);
+        std::printf("%12s %12s %8s\n", "copy", "ring", "speedup");
+        std::printf("%12.3g %12.3g %7.2fx\n\n", copy, ring, ring / copy);
+    }
+
+    // Every (rotation, anchor x, anchor y) candidate of each piece, one collides() at a time
+    // versus one legalPlacements() map per piece type
+    void BenchPlacements() {
+        const int iters = 200'000;
+        std::mt19937 rng{ 1337u };
+        game::Game g;
+        BuildBoard(g, 12, 0, rng);
+
+        int sink = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < iters; ++i)
+            for (int t = 0; t < 7; ++t) for (int r = 0; r < 4; ++r)
+                for (int y = 0; y < game::PLACEMENT_ROWS<game::BOARD_H>; ++y) for (int x = -1; x < game::BOARD_W; ++x)
+                    sink += !game::collides(g, { x, y, r, t });
+        auto t1 = std::chrono::steady_clock::now();
+        game::PlacementMap<game::BOARD_W, game::BOARD_H> m;
+        for (int i = 0; i < iters; ++i)
+            for (int t = 0; t < 7; ++t) { game::legalPlacements(g, t, m); sink += m.legal[i & 3][i & 15]; }
+        auto t2 = std::chrono::steady_clock::now();
+        g_Sink = g_Sink + sink;
+
+        double scalar = std::chrono::duration<double, std::nano>(t1 - t0).count() / (iters * 7.0);
+        double batch = std::chrono::duration<double, std::nano>(t2 - t1).count() / (iters * 7.0);
+        std::printf("legal placements of one piece (ns/piece)\n");
+        std::printf("%12s %12s %8s\n", "collides", "batch", "speedup");
+        std::printf("%12.1f %12.1f %7.1fx\n", scalar, batch, scalar / batch);
+    }
+
+    // Save into / Restore from a small ring of snapshots of a mid-game board
+    void BenchSnapshots() {
+        const int iters = 20'000'000;
+        std::mt19937 rng{ 1337u };
+        game::Game g;
+        BuildBoard(g, 12, 0, rng);
+        g.bag.refill(5); game::spawn(g);
+        static game::GameSnapshot ring[64];
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < iters; ++i) { g.score = i; game::Save(g, ring[i & 63]); }
+        auto t1 = std::chrono::steady_clock::now();
+        int sink = 0;
+        for (int i = 0; i < iters; ++i) { game::Restore(g, ring[i & 63]); sink += g.score; }
+        auto t2 = std::chrono::steady_clock::now();
+        g_Sink = g_Sink + sink;
+
+        double save = std::chrono::duration<double>(t1 - t0).count();
+        double restore = std::chrono::duration<double>(t2 - t1).count();
+        std::printf("\nsnapshots (%zu bytes)\n", sizeof(game::GameSnapshot));
+        std::printf("%12s %12s\n", "save M/s", "restore M/s");
+        std::printf("%12.1f %12.1f\n", iters / save * 1e-6, iters / restore * 1e-6);
+    }
+
+    // Reachable placements of every piece type on a mid-game board
+    void BenchMoveGen() {
+        const int iters = 200'000;
+        std::mt19937 rng{ 1337u };
+        game::Game g;
+        BuildBoard(g, 8, 0, rng);
+        static game::PlacementList<game::BOARD_W, game::BOARD_H> list;
+
+        int sink = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < iters; ++i) { game::GeneratePlacements(g, i % 7, list); sink += list.count; }
+        auto t1 = std::chrono::steady_clock::now();
+        g_Sink = g_Sink + sink;
+
+        double sec = std::chrono::duration<double>(t1 - t0).count();
+        std::printf("\nGeneratePlacements (stack 8)\n");
+        std::printf("%12s %12s %12s\n", "calls/s", "ns/call", "placements");
+        std::printf("%12.0f %12.1f %12.1f\n", iters / sec, sec * 1e9 / iters, (double)sink / iters);
+    }
+
+    // The cell-by-cell scan the feature kernels replace: unpack the board into a grid, then
+    // walk every column and row of it
+    ai::Features MeasureByCells(const game::Game& g, int lines) {
+        constexpr int W = game::BOARD_W, H = game::BOARD_H;
+        int cell[H][W];
+        for (int y = 0; y < H; ++y) for (int x = 0; x < W; ++x) cell[y][x] = (g.row(y) >> x) & 1;
+        auto at = [&](int x, int y) { return x < 0 || x >= W || y < 0 ? 1 : (y >= H ? 0 : cell[y][x]); };
+
+        ai::Features f{};
+        f.lines = lines;
+        int heights[W];
+        for (int x = 0; x < W; ++x) {
+            int h = H;
+            while (h > 0 && !cell[h - 1][x]) --h;
+            heights[x] = h;
+            bool gapBelow = false;
+            for (int y = 0; y < H; ++y) {
+                if (cell[y][x]) f.coveredCells += gapBelow;
+                else if (y < h) { ++f.holes; gapBelow = true; }
+                f.colTransitions += at(x, y) != at(x, y - 1);
+            }
+            int run = 0;
+            for (int y = h; y < H; ++y) {
+                if (at(x - 1, y) && at(x + 1, y)) f.wellSums += ++run;
+                else run = 0;
+            }
+        }
+        for (int y = 0; y < H; ++y) for (int x = 0; x <= W; ++x) f.rowTransitions += at(x - 1, y) != at(x, y);
+        ai::kernels::fromHeights<W, H>(heights, f);
+        return f;
+    }
+
+    // Full feature vector of a mid-game board: per-cell scan versus the bitboard kernels
+    void BenchFeatures() {
+        const int iters = 2'000'000, BOARDS = 64;
+        std::mt19937 rng{ 1337u };
+        static game::Game boards[BOARDS];
+        for (int i = 0; i < BOARDS; ++i) {
+            BuildBoard(boards[i], 4 + i % 10, 0, rng);
+            for (int k = 0; k < 6; ++k) game::setCell(boards[i], (int)(rng() % game::BOARD_W), 4 + i % 10 + k, 1);
+            game::recomputeMetrics(boards[i]);
+        }
+
+        auto time = [&](auto&& measure) {
+            int sink = 0;
+            auto t0 = std::chrono::steady_clock::now();
+            for (int i = 0; i < iters; ++i) {
+                ai::Features f = measure(boards[i & (BOARDS - 1)]);
+                sink += f.coveredCells + f.rowTransitions + f.colTransitions + f.wellSums + f.holes;
+            }
+            g_Sink = g_Sink + sink;
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / iters;
+        };
+        double cells = time([](const game::Game& g) { return MeasureByCells(g, 0); });
+        double rows = time([](const game::Game& g) { return ai::Measure(g, 0); });
+        double cols = time([](const game::Game& g) {
+            ai::kernels::ColumnBits<game::BOARD_H> c[game::BOARD_W];
+            ai::Features f{};
+            ai::kernels::transpose(g, c);
+            ai::kernels::fromColumns<game::BOARD_W, game::BOARD_H>(c, f);
+            return f;
+        });
+        std::printf("\nfeature vector of one board (ns/board)\n");
+        std::printf("%12s %12s %12s %8s\n", "cells", "rows", "columns", "speedup");
+        std::printf("%12.1f %12.1f %12.1f %7.1fx\n", cells, rows, cols, cells / std::min(rows, cols));
+    }
+
+    // Beam search throughput by thread count, on the same position every time
+    void BenchBeamSearch() {
+        game::Game g;
+        g.bag.seed(7); g.bag.refill(6); // the active piece and five in the queue: all six plies known
+        std::mt19937 rng{ 1337u };
+        BuildBoard(g, 6, 0, rng);
+        game::spawn(g);
+        int hw = (int)std::max(1u, std::thread::hardware_concurrency());
+        std::printf("\nbeam search, width 256, depth 6 (%d hardware threads)\n", hw);
+        std::printf("%8s %12s %8s\n", "threads", "nodes/s", "speedup");
+        double base = 0;
+        for (int t = 1; t <= std::min(hw, 16); t *= 2) {
+            ai::BeamSearch search({ 256, 6, t });
+            search.Think(g); // warm up
+            std::uint64_t n0 = search.NodesExpanded();
+            auto t0 = std::chrono::steady_clock::now();
+            for (int i = 0; i < 10; ++i) g_Sink = g_Sink + search.Think(g).moveCount;
+            double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            double rate = (search.NodesExpanded() - n0) / sec;
+            if (t == 1) base = rate;
+            std::printf("%8d %12.3g %7.2fx\n", t, rate, rate / base);
+        }
+    }
+
+    // Expectimax throughput by thread count: five known pieces, then one chance ply
+    void BenchExpectimax() {
+        game::Game g;
+        g.bag.seed(7); g.bag.refill(5);
+        std::mt19937 rng{ 1337u };
+        BuildBoard(g, 6, 0, rng);
+        game::spawn(g);
+        int hw = (int)std::max(1u, std::thread::hardware_concurrency());
+        std::printf("\nexpectimax, depth 6, branch 4 (%d hardware threads)\n", hw);
+        std::printf("%8s %12s %8s\n", "threads", "nodes/s", "speedup");
+        double base = 0;
+        for (int t = 1; t <= std::min(hw, 16); t *= 2) {
+            ai::Expectimax search({ 6, 4, t });
+            search.Think(g); // warm up
+            std::uint64_t n0 = search.NodesExpanded();
+            auto t0 = std::chrono::steady_clock::now();
+            for (int i = 0; i < 5; ++i) g_Sink = g_Sink + search.Think(g).moveCount;
+            double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            double rate = (search.NodesExpanded() - n0) / sec;
+            if (t == 1) base = rate;
+            std::printf("%8d %12.3g %7.2fx\n", t, rate, rate / base);
+        }
+    }
+
+} // namespace
+
+int main() {
+    BenchClearLines<game::Game>("standard");
+    BenchClearLines<game::PracticeGame>("practice");
+    BenchClearLines<game::PartyGame>("party");
+    BenchClearLines<game::StressGame>("stress");
+    BenchGarbage<game::Game>("standard", 1);
+    BenchGarbage<game::StressGame>("stress", 4);
+    BenchGarbage<game::StressGame>("stress", 16);
+    BenchPlacements();
+    BenchSnapshots();
+    BenchMoveGen();
+    BenchFeatures();
+    BenchBeamSearch();
+    BenchExpectimax();
+    return 0;
+}
@@ -0,0 +1,93 @@
+// Headless bot runner: lets the AI play whole games without a window, for load and soak tests.
+// By default pieces are placed directly; --sim feeds the bot's buttons through the real-time
+// simulation tick by tick instead (gravity, DAS, garbage and all). --beam switches from the
+// greedy player to the multithreaded beam search, --expectimax to the expectimax search.
+#include "../ai/BeamSearch.h"
+#include "../ai/Expectimax.h"
+#include "../game/Simulation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+int main(int argc, char** argv) {
+    int games = 10, maxPieces = 10'000, levelIndex = 0;
+    std::uint64_t seed = 1;
+    bool sim = false, beam = false, expecti = false;
+    ai::SearchParams search;
+    ai::ExpectimaxParams tree;
+    ai::Weights weights;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--games") == 0 && i + 1 < argc) games = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--pieces") == 0 && i + 1 < argc) maxPieces = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--level") == 0 && i + 1 < argc) levelIndex = std::clamp(std::atoi(argv[++i]), 0, 2);
+        else if (std::strcmp(argv[i], "--sim") == 0) sim = true;
+        else if (std::strcmp(argv[i], "--weights") == 0 && i + 1 < argc) { if (!ai::LoadWeights(argv[++i], weights)) return 1; }
+        else if (std::strcmp(argv[i], "--beam") == 0 && i + 1 < argc) { beam = true; search.width = std::max(1, std::atoi(argv[++i])); }
+        else if (std::strcmp(argv[i], "--depth") == 0 && i + 1 < argc) search.depth = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--expectimax") == 0 && i + 1 < argc) { expecti = true; tree.depth = std::max(1, std::atoi(argv[++i])); }
+        else if (std::strcmp(argv[i], "--branch") == 0 && i + 1 < argc) tree.branch = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--hash") == 0 && i + 1 < argc) tree.hashMegabytes = std::max(0, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--mirror") == 0) tree.mirror = true;
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) search.threads = tree.threads = std::max(0, std::atoi(argv[++i]));
+        else {
+            std::fprintf(stderr, "usage: tetris_bot [--games N] [--pieces N] [--seed S] [--level 0-2] [--sim] [--weights FILE]\n"
+                "                  [--beam WIDTH [--depth D] | --expectimax DEPTH [--branch B] [--hash MB] [--mirror]]\n"
+                "                  [--threads T]\n");
+            return 2;
+        }
+    }
+
+    std::unique_ptr<ai::Planner> player;
+    if (expecti) player = std::make_unique<ai::Expectimax>(tree, weights);
+    else if (beam) player = std::make_unique<ai::BeamSearch>(search, weights);
+    else player = std::make_unique<ai::Player>(weights);
+    ai::Driver driver{ *player };
+    game::Game g;
+    game::Simulation s{ g };
+    std::uint64_t totalPieces = 0, totalLines = 0, totalTicks = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int n = 0; n < games; ++n) {
+        g = game::Game{};
+        g.levelIndex = levelIndex;
+        g.level = 1 + (levelIndex == 0 ? 0 : (levelIndex == 1 ? 4 : 9));
+        s.Start(seed + n);
+        driver.Reset();
+
+        int pieces = 0;
+        if (sim) {
+            int head = g.bag.queueHead;
+            while (!g.gameOver && pieces < maxPieces) {
+                s.Step(driver.Next(g));
+                if (g.bag.queueHead != head) { head = g.bag.queueHead; ++pieces; }
+            }
+            totalTicks += s.Tick();
+        }
+        else {
+            while (pieces < maxPieces && player->PlayPiece(g)) ++pieces;
+        }
+        std::printf("game %3d  seed %llu  pieces %6d  lines %6d  score %9d%s\n", n, (unsigned long long)(seed + n),
+            pieces, g.lines, g.score, g.gameOver ? "  (topped out)" : "");
+        totalPieces += pieces; totalLines += g.lines;
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::printf("%d games, %llu pieces, %llu lines in %.3f s: %.0f pieces/s",
+        games, (unsigned long long)totalPieces, (unsigned long long)totalLines, sec, totalPieces / sec);
+    if (sim) std::printf(", %.2f M ticks/s", totalTicks / sec * 1e-6);
+    if (expecti) {
+        const auto& ex = static_cast<const ai::Expectimax&>(*player);
+        std::printf(", %.2f M nodes/s on %d threads, %llu hash hits", ex.NodesExpanded() / sec * 1e-6, ex.Threads(),
+            (unsigned long long)ex.HashHits());
+        if (ex.Table()) std::printf(" (%zu MB table%s)", ex.Table()->Bytes() >> 20, ex.Table()->HugePages() ? ", huge pages" : "");
+    }
+    else if (beam) {
+        const auto& bs = static_cast<const ai::BeamSearch&>(*player);
+        std::printf(", %.2f M nodes/s on %d threads", bs.NodesExpanded() / sec * 1e-6, bs.Threads());
+    }
+    std::printf("\n");
+    return 0;
+}
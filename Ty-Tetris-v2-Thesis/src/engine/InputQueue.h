@@ -0,0 +1,40 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace eng {
+
+    // A key going down (action != 0) or up, stamped with steady_clock nanoseconds
+    struct KeyEvent { std::int64_t timeNs; int key; int action; };
+
+    // Single-producer / single-consumer ring of key events. The window's key callback pushes,
+    // the game loop peeks and pops at tick boundaries; neither side blocks or allocates.
+    class InputQueue {
+    public:
+        static constexpr std::uint32_t CAPACITY = 256; // power of two
+
+        // Producer side; false (event dropped) when the consumer has fallen a full ring behind
+        bool Push(const KeyEvent& e) {
+            std::uint32_t tail = m_Tail.load(std::memory_order_relaxed);
+            if (tail - m_Head.load(std::memory_order_acquire) == CAPACITY) return false;
+            m_Events[tail & (CAPACITY - 1)] = e;
+            m_Tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side
+        bool Peek(KeyEvent& e) const {
+            std::uint32_t head = m_Head.load(std::memory_order_relaxed);
+            if (head == m_Tail.load(std::memory_order_acquire)) return false;
+            e = m_Events[head & (CAPACITY - 1)];
+            return true;
+        }
+        void Pop() { m_Head.store(m_Head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    private:
+        KeyEvent m_Events[CAPACITY] = {};
+        alignas(64) std::atomic<std::uint32_t> m_Head{ 0 };
+        alignas(64) std::atomic<std::uint32_t> m_Tail{ 0 };
+    };
+
+} // namespace eng
@@ -0,0 +1,140 @@
+#include "Scheduler.h"
+#include <cassert>
+
+namespace eng {
+
+    namespace {
+        thread_local int t_Worker = -1;                    // index in t_Scheduler's workers
+        thread_local const Scheduler* t_Scheduler = nullptr; // the scheduler this thread works for
+
+        // Spin lock for a deque: held only for a few copies, never across a task
+        struct SpinGuard {
+            std::atomic_flag& f;
+            explicit SpinGuard(std::atomic_flag& flag) : f(flag) { while (f.test_and_set(std::memory_order_acquire)) std::this_thread::yield(); }
+            ~SpinGuard() { f.clear(std::memory_order_release); }
+        };
+
+        constexpr int MAX_STEAL = 64; // tasks moved per steal (half the victim's deque, up to this)
+    }
+
+    Scheduler::Scheduler(int threads) {
+        if (threads <= 0) threads = (int)std::max(1u, std::thread::hardware_concurrency());
+        for (int i = 0; i < threads; ++i) {
+            m_Workers.push_back(std::make_unique<Worker>());
+            m_Workers.back()->rng = 0x9E3779B9u * (i + 1);
+        }
+        for (int i = 1; i < threads; ++i) m_Threads.emplace_back(&Scheduler::workerLoop, this, i);
+    }
+
+    Scheduler::~Scheduler() {
+        m_Stop.store(true);
+        { std::lock_guard<std::mutex> lock(m_SleepMutex); }
+        m_Wake.notify_all();
+        for (std::thread& t : m_Threads) t.join();
+    }
+
+    int Scheduler::WorkerIndex() { return t_Worker; }
+
+    // A Run may be called from a worker of another scheduler (or from inside one of its tasks):
+    // the caller's index is put back when it returns
+    Scheduler::Caller Scheduler::enter() {
+        assert(t_Scheduler != this && "Scheduler::Run is not re-entrant");
+        Caller c{ t_Worker, t_Scheduler };
+        t_Worker = 0; t_Scheduler = this;
+        return c;
+    }
+    void Scheduler::leave(const Caller& c) { t_Worker = c.worker; t_Scheduler = c.scheduler; }
+
+    void Scheduler::push(const Task& t) {
+        assert(t_Scheduler == this && "spawn from inside this scheduler's Run");
+        Worker& w = *m_Workers[t_Worker];
+        bool queued = false;
+        {
+            SpinGuard guard(w.lock);
+            if (w.bottom - w.top < DEQUE_CAP) {
+                w.tasks[w.bottom & (DEQUE_CAP - 1)] = t;
+                ++w.bottom;
+                m_Queued.fetch_add(1);
+                queued = true;
+            }
+        }
+        if (!queued) { execute(t); return; } // deque full: run it right here
+        if (m_Sleeping.load() > 0) {
+            { std::lock_guard<std::mutex> lock(m_SleepMutex); } // a sleeper is either waiting or will see the task
+            m_Wake.notify_one();
+        }
+    }
+
+    bool Scheduler::popOwn(int wi, Task& out) {
+        Worker& w = *m_Workers[wi];
+        SpinGuard guard(w.lock);
+        if (w.bottom == w.top) return false;
+        --w.bottom;
+        out = w.tasks[w.bottom & (DEQUE_CAP - 1)];
+        m_Queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Take the older half of some other worker's deque: run the first, keep the rest
+    bool Scheduler::stealInto(int thief, Task& out) {
+        int n = Size();
+        if (n < 2) return false;
+        Worker& me = *m_Workers[thief];
+        me.rng ^= me.rng << 13; me.rng ^= me.rng >> 17; me.rng ^= me.rng << 5;
+        int start = (int)(me.rng % (std::uint32_t)n);
+        Task batch[MAX_STEAL];
+        for (int k = 0; k < n; ++k) {
+            int v = (start + k) % n;
+            if (v == thief) continue;
+            Worker& victim = *m_Workers[v];
+            int take;
+            {
+                SpinGuard guard(victim.lock);
+                int count = victim.bottom - victim.top;
+                if (count == 0) continue;
+                take = std::min((count + 1) / 2, MAX_STEAL);
+                for (int i = 0; i < take; ++i) batch[i] = victim.tasks[(victim.top + i) & (DEQUE_CAP - 1)];
+                victim.top += take;
+            }
+            out = batch[0];
+            m_Queued.fetch_sub(1, std::memory_order_relaxed);
+            if (take > 1) {
+                SpinGuard guard(me.lock); // own deque is empty when stealing, so the batch fits
+                for (int i = 1; i < take; ++i) me.tasks[(me.bottom++) & (DEQUE_CAP - 1)] = batch[i];
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void Scheduler::execute(const Task& t) {
+        t.invoke(t);
+        t.pending->fetch_sub(1, std::memory_order_release);
+    }
+
+    // Join: keep the worker busy with its own tasks (or stolen ones) until the group is done
+    void Scheduler::helpUntil(const std::atomic<int>& pending) {
+        int w = t_Worker;
+        while (pending.load(std::memory_order_acquire) > 0) {
+            Task t;
+            if (popOwn(w, t) || stealInto(w, t)) execute(t);
+            else std::this_thread::yield();
+        }
+    }
+
+    void Scheduler::workerLoop(int w) {
+        t_Worker = w; t_Scheduler = this;
+        int idle = 0;
+        while (!m_Stop.load(std::memory_order_relaxed)) {
+            Task t;
+            if (popOwn(w, t) || stealInto(w, t)) { execute(t); idle = 0; continue; }
+            if (++idle < 64) { std::this_thread::yield(); continue; }
+            std::unique_lock<std::mutex> lock(m_SleepMutex);
+            m_Sleeping.fetch_add(1);
+            m_Wake.wait(lock, [&] { return m_Stop.load() || m_Queued.load() > 0; });
+            m_Sleeping.fetch_sub(1);
+            idle = 0;
+        }
+    }
+
+} // namespace eng
@@ -0,0 +1,126 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace eng {
+
+    class Scheduler;
+
+    // A unit of work: a small trivially-copyable closure stored inline, so spawning never allocates
+    struct Task {
+        static constexpr std::size_t STORAGE = 48;
+        void (*invoke)(const Task&) = nullptr;
+        std::atomic<int>* pending = nullptr; // group counter to decrement when done
+        alignas(16) unsigned char storage[STORAGE];
+    };
+
+    // Work-stealing scheduler. Each worker owns a deque: it pushes and pops its own tasks at the
+    // bottom (depth first, cache warm) while idle workers steal half of a victim's tasks from the
+    // top (the oldest, usually biggest subtrees). The thread calling Run takes part as worker 0.
+    class Scheduler {
+    public:
+        explicit Scheduler(int threads = 0); // 0: one per hardware thread
+        ~Scheduler();
+        Scheduler(const Scheduler&) = delete;
+        Scheduler& operator=(const Scheduler&) = delete;
+
+        int Size() const { return (int)m_Workers.size(); }
+
+        // Index of the worker running the calling code, in [0, Size()); -1 outside the scheduler
+        static int WorkerIndex();
+
+        // Run `f` on the calling thread as worker 0 and help with everything it forks until it
+        // returns. One Run at a time per scheduler, and not re-entrant: no Run from inside this
+        // scheduler's own Run or tasks. From a worker of another scheduler it is fine.
+        template <class F>
+        void Run(F&& f) {
+            Caller caller = enter();
+            f();
+            leave(caller);
+        }
+
+        // fn(i) for every i in [begin, end), split in halves down to `grain` indices and stolen
+        // as needed. Must be called from inside Run (or a task).
+        template <class F>
+        void ParallelFor(int begin, int end, int grain, const F& fn);
+
+        // Fork/join: Spawn queues a closure (at most Task::STORAGE bytes, trivially copyable;
+        // capture by reference or pointer), Wait runs or steals tasks until all spawned ones are done
+        class TaskGroup {
+        public:
+            explicit TaskGroup(Scheduler& s) : m_Scheduler(&s) {}
+            ~TaskGroup() { Wait(); }
+
+            template <class F>
+            void Spawn(const F& f) {
+                static_assert(sizeof(F) <= Task::STORAGE && alignof(F) <= 16, "closure too large for a task");
+                static_assert(std::is_trivially_copyable_v<F>, "task closures must be trivially copyable");
+                Task t;
+                t.invoke = [](const Task& self) { (*std::launder(reinterpret_cast<const F*>(self.storage)))(); };
+                t.pending = &m_Pending;
+                ::new (t.storage) F(f);
+                m_Pending.fetch_add(1, std::memory_order_relaxed);
+                m_Scheduler->push(t);
+            }
+            void Wait() { m_Scheduler->helpUntil(m_Pending); }
+
+        private:
+            Scheduler* m_Scheduler;
+            std::atomic<int> m_Pending{ 0 };
+        };
+
+    private:
+        static constexpr int DEQUE_CAP = 1024; // power of two; a full deque runs new tasks inline
+
+        struct alignas(64) Worker {
+            std::atomic_flag lock = ATOMIC_FLAG_INIT;
+            int top = 0, bottom = 0; // tasks are [top, bottom), indices wrap
+            std::uint32_t rng = 0;
+            Task tasks[DEQUE_CAP];
+        };
+
+        void push(const Task& t);
+        bool popOwn(int w, Task& out);
+        bool stealInto(int thief, Task& out);
+        void execute(const Task& t);
+        void helpUntil(const std::atomic<int>& pending);
+        void workerLoop(int w);
+        // What the thread calling Run was doing before, put back when Run returns
+        struct Caller { int worker; const Scheduler* scheduler; };
+        Caller enter();
+        void leave(const Caller& c);
+
+        std::vector<std::unique_ptr<Worker>> m_Workers;
+        std::vector<std::thread> m_Threads;
+        std::atomic<int> m_Queued{ 0 };   // tasks sitting in any deque
+        std::atomic<int> m_Sleeping{ 0 };
+        std::atomic<bool> m_Stop{ false };
+        std::mutex m_SleepMutex;
+        std::condition_variable m_Wake;
+    };
+
+    template <class F>
+    void Scheduler::ParallelFor(int begin, int end, int grain, const F& fn) {
+        if (end - begin <= std::max(grain, 1)) {
+            for (int i = begin; i < end; ++i) fn(i);
+            return;
+        }
+        int mid = begin + (end - begin) / 2;
+        TaskGroup group(*this);
+        Scheduler* s = this;
+        const F* f = &fn;
+        group.Spawn([s, f, mid, end, grain] { s->ParallelFor(mid, end, grain, *f); });
+        ParallelFor(begin, mid, grain, fn);
+        group.Wait();
+    }
+
+} // namespace eng
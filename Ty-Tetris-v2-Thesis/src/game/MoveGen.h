@@ -0,0 +1,154 @@
+#pragma once
+#include "Placements.h"
+
+namespace game {
+
+    // One input of a placement path. SoftDrop moves the piece down one row.
+    enum class Move : std::uint8_t { Left, Right, RotateCW, RotateCCW, SoftDrop };
+
+    // Lowest rotation with the same footprint (O: all four; I, S, Z: 0/2 and R/L).
+    // Equal footprints share their bounding-box corner, so this is the dedupe key of a lock.
+    constexpr std::array<std::array<std::int8_t, 4>, 7> BuildCanonicalRotations() {
+        std::array<std::array<std::int8_t, 4>, 7> t{};
+        for (int type = 0; type < 7; ++type) {
+            unsigned shape[4] = {};
+            for (int r = 0; r < 4; ++r) {
+                const Cell* pc = PIECES[type].rot[r];
+                int minX = pc[0].x, minY = pc[0].y;
+                for (int i = 1; i < 4; ++i) { minX = pc[i].x < minX ? pc[i].x : minX; minY = pc[i].y < minY ? pc[i].y : minY; }
+                for (int i = 0; i < 4; ++i) shape[r] |= 1u << ((pc[i].y - minY) * 4 + pc[i].x - minX);
+                t[type][r] = (std::int8_t)r;
+                for (int q = 0; q < r; ++q) if (shape[q] == shape[r]) { t[type][r] = (std::int8_t)q; break; }
+            }
+        }
+        return t;
+    }
+
+    inline constexpr auto CANONICAL_ROTATION = BuildCanonicalRotations();
+
+    // Every distinct resting placement of one piece reachable from spawn, with the BFS tree
+    // kept so each placement's shortest input path can be read back. Fixed size: reuse one
+    // list across calls and nothing is allocated.
+    template <int W, int H>
+    struct PlacementList {
+        static constexpr int ROWS = PLACEMENT_ROWS<H>;
+        static constexpr int MAX_NODES = 4 * W * ROWS;
+
+        // i, row: bottom-left corner of the piece's bounding box, as in PlacementMap
+        struct Node { std::int16_t i, row; std::uint8_t r; Move move; std::int32_t parent; };
+
+        PlacementMap<W, H> map;
+        Node nodes[MAX_NODES];
+        int nodeCount = 0;
+        std::int32_t locked[MAX_NODES]; // node index of each placement
+        int count = 0;
+
+        Active operator[](int k) const { return at(locked[k]); }
+
+        // Inputs from spawn to placement k, written in order; returns the path length
+        // (only the first `cap` moves are written). `after`, if given, receives the piece
+        // as it stands after each move.
+        int Path(int k, Move* out, int cap, Active* after = nullptr) const {
+            int len = 0;
+            for (int n = locked[k]; nodes[n].parent >= 0; n = nodes[n].parent) len += steps(n);
+            int i = len;
+            for (int n = locked[k]; nodes[n].parent >= 0; n = nodes[n].parent)
+                for (int s = steps(n); s > 0; --s) {
+                    if (--i >= cap) continue;
+                    out[i] = nodes[n].move;
+                    if (after) { after[i] = at(n); after[i].y += steps(n) - s; }
+                }
+            return len;
+        }
+
+    private:
+        Active at(int node) const {
+            const Node& n = nodes[node];
+            const PieceMask<W>& pm = PIECE_MASKS<W>[map.type][n.r][MASK_X_BIAS];
+            return { n.i - pm.minX, n.row - pm.minY, n.r, map.type };
+        }
+
+        // A soft drop node may stand for several rows of falling through open air
+        int steps(int n) const {
+            return nodes[n].move == Move::SoftDrop ? nodes[nodes[n].parent].row - nodes[n].row : 1;
+        }
+    };
+
+    // BFS over (x, y, r) from the spawn position with left, right, both rotations (SRS kicks)
+    // and one-row soft drops, so tucks and kicked spins under overhangs are all found.
+    // Two rows or more above the stack no kick can reach a filled cell and every height
+    // behaves the same, so the piece falls straight to that level instead of row by row.
+    // Moves that would take the piece above the map's headroom are not explored.
+    template <int W, int H>
+    void GeneratePlacements(const BasicGame<W, H>& g, int type, PlacementList<W, H>& out) {
+        using Row = RowBits<W>;
+        using List = PlacementList<W, H>;
+        constexpr int ROWS = List::ROWS;
+        out.nodeCount = out.count = 0;
+        legalPlacements(g, type, out.map);
+        const auto& legal = out.map.legal;
+
+        // Everything below works on bounding-box corners; rotation and kicks become offsets
+        int minX[4], minY[4], span[4];
+        for (int r = 0; r < 4; ++r) {
+            const PieceMask<W>& pm = PIECE_MASKS<W>[type][r][MASK_X_BIAS];
+            minX[r] = pm.minX; minY[r] = pm.minY; span[r] = pm.maxX - pm.minX;
+        }
+        const int tests = type == 1 ? 1 : KICK_TESTS;
+        int kickI[4][2][KICK_TESTS], kickRow[4][2][KICK_TESTS];
+        for (int r = 0; r < 4; ++r) for (int d = 0; d < 2; ++d) {
+            int to = (r + (d == 0 ? 1 : 3)) & 3;
+            const Kick* k = KICKS[type == 0][r][d];
+            for (int j = 0; j < tests; ++j) {
+                kickI[r][d][j] = k[j].x + minX[to] - minX[r];
+                kickRow[r][d][j] = k[j].y + minY[to] - minY[r];
+            }
+        }
+        auto legalAt = [&](int r, int i, int row) {
+            if (row < 0 || i < 0 || i >= W) return false;
+            if (row >= ROWS) return i + span[r] < W; // open sky
+            return ((legal[r][row] >> i) & 1) != 0;
+        };
+
+        int top = 0;
+        for (int x = 0; x < W; ++x) top = std::max(top, (int)g.heights[x]);
+        const int openAir = top + 2; // bottom rows at or above this see no difference in height
+
+        Row seen[4][ROWS] = {};
+        Row done[4][ROWS] = {};
+        auto visit = [&](int r, int i, int row, Move mv, int parent) {
+            if (row >= ROWS || ((seen[r][row] >> i) & 1)) return;
+            seen[r][row] |= (Row)(Row(1) << i);
+            out.nodes[out.nodeCount++] = { (std::int16_t)i, (std::int16_t)row, (std::uint8_t)r, mv, parent };
+        };
+
+        int spawnI = W / 2 - 1 + minX[0], spawnRow = H - 2 + minY[0];
+        if (!legalAt(0, spawnI, spawnRow)) return;
+        visit(0, spawnI, spawnRow, Move::SoftDrop, -1);
+
+        for (int n = 0; n < out.nodeCount; ++n) {
+            const typename List::Node nd = out.nodes[n];
+            int r = nd.r, i = nd.i, row = nd.row;
+
+            if (legalAt(r, i - 1, row)) visit(r, i - 1, row, Move::Left, n);
+            if (legalAt(r, i + 1, row)) visit(r, i + 1, row, Move::Right, n);
+            for (int d = 0; d < 2; ++d) {
+                int to = (r + (d == 0 ? 1 : 3)) & 3;
+                for (int j = 0; j < tests; ++j) {
+                    int ti = i + kickI[r][d][j], tr = row + kickRow[r][d][j];
+                    if (legalAt(to, ti, tr)) { visit(to, ti, tr, d == 0 ? Move::RotateCW : Move::RotateCCW, n); break; }
+                }
+            }
+
+            if (row > openAir) { visit(r, i, openAir, Move::SoftDrop, n); continue; }
+            if (row > 0 && ((legal[r][row - 1] >> i) & 1)) { visit(r, i, row - 1, Move::SoftDrop, n); continue; }
+
+            // Resting: record it unless an equal footprint was locked already
+            int cr = CANONICAL_ROTATION[type][r];
+            if ((done[cr][row] >> i) & 1) continue;
+            done[cr][row] |= (Row)(Row(1) << i);
+            out.locked[out.count++] = n;
+        }
+    }
+
+} // namespace game
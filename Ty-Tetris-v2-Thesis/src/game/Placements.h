@@ -0,0 +1,84 @@
+#pragma once
+#include "Tetris.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace game {
+
+    // Rows of the legality map: every bottom row a piece can occupy on the board, the spawn
+    // rows and a little headroom above, rounded up to a whole number of 16-lane vectors.
+    template <int H>
+    inline constexpr int PLACEMENT_ROWS = (H + 4 + 15) / 16 * 16;
+
+    // Legality of every (rotation, column, row) placement of one piece type.
+    // Bit i of legal[r][row] is set when the piece in rotation r fits with the bottom-left
+    // corner of its bounding box on (i, row), i.e. anchored at x = i - minX, y = row - minY.
+    template <int W, int H>
+    struct PlacementMap {
+        int type = 0;
+        RowBits<W> legal[4][PLACEMENT_ROWS<H>];
+    };
+
+    // For each cell (dx, dy) of the rotation, the free rows dy - minY above the bottom row,
+    // shifted right by dx - minX, say which bottom-left columns leave that cell free. Columns
+    // past the right wall read as occupied, so no separate bounds mask is needed.
+    // 16-bit rows (the standard board) get an AVX2 or SSE2 kernel, other widths the scalar loop.
+    template <int W, int H>
+    void legalPlacements(const BasicGame<W, H>& g, int type, PlacementMap<W, H>& out) {
+        using Row = typename BasicGame<W, H>::Row;
+        constexpr Row FULL = BasicGame<W, H>::FULL_ROW;
+        constexpr int ROWS = PLACEMENT_ROWS<H>;
+        alignas(32) Row freeRows[ROWS + 4];
+        for (int y = 0; y < H; ++y) freeRows[y] = (Row)(~g.row(y) & FULL);
+        for (int y = H; y < ROWS + 4; ++y) freeRows[y] = FULL;
+
+        out.type = type;
+        for (int r = 0; r < 4; ++r) {
+            const Cell* pc = PIECES[type].rot[r];
+            const PieceMask<W>& pm = PIECE_MASKS<W>[type][r][MASK_X_BIAS];
+            int dy[4], dx[4];
+            for (int i = 0; i < 4; ++i) { dy[i] = pc[i].y - pm.minY; dx[i] = pc[i].x - pm.minX; }
+            Row* dst = out.legal[r];
+            int row = 0;
+            if constexpr (sizeof(Row) == 2) {
+#if defined(__AVX2__)
+                for (; row < ROWS; row += 16) {
+                    __m256i acc = _mm256_set1_epi16(-1);
+                    for (int i = 0; i < 4; ++i) {
+                        __m256i v = _mm256_loadu_si256((const __m256i*)(freeRows + row + dy[i]));
+                        acc = _mm256_and_si256(acc, _mm256_srl_epi16(v, _mm_cvtsi32_si128(dx[i])));
+                    }
+                    _mm256_storeu_si256((__m256i*)(dst + row), acc);
+                }
+#elif defined(__SSE2__) || defined(_M_X64)
+                for (; row < ROWS; row += 8) {
+                    __m128i acc = _mm_set1_epi16(-1);
+                    for (int i = 0; i < 4; ++i) {
+                        __m128i v = _mm_loadu_si128((const __m128i*)(freeRows + row + dy[i]));
+                        acc = _mm_and_si128(acc, _mm_srl_epi16(v, _mm_cvtsi32_si128(dx[i])));
+                    }
+                    _mm_storeu_si128((__m128i*)(dst + row), acc);
+                }
+#endif
+            }
+            for (; row < ROWS; ++row) {
+                Row acc = FULL;
+                for (int i = 0; i < 4; ++i) acc &= (Row)(freeRows[row + dy[i]] >> dx[i]);
+                dst[row] = acc;
+            }
+        }
+    }
+
+    // Same answer as !collides(g, a) for a map built from g
+    template <int W, int H>
+    inline bool placementLegal(const PlacementMap<W, H>& m, const Active& a) {
+        const PieceMask<W>& pm = PIECE_MASKS<W>[a.type][a.r][MASK_X_BIAS];
+        int i = a.x + pm.minX, row = a.y + pm.minY;
+        if (i < 0 || i >= W || row < 0) return false;
+        if (row >= PLACEMENT_ROWS<H>) return i + (pm.maxX - pm.minX) < W; // open sky
+        return (m.legal[a.r][row] >> i) & 1;
+    }
+
+} // namespace game
@@ -0,0 +1,84 @@
+#include "Render.h"
+#include "../engine/Renderer.h"
+
+namespace game {
+
+    const std::array<std::array<float, 3>, 8> COLORS = { {
+        {0.08f,0.08f,0.08f},
+        {0.0f, 0.9f, 0.9f},
+        {0.9f, 0.9f, 0.0f},
+        {0.6f, 0.0f, 0.9f},
+        {0.0f, 0.9f, 0.2f},
+        {0.9f, 0.0f, 0.2f},
+        {0.0f, 0.2f, 0.9f},
+        {0.9f, 0.5f, 0.0f}
+    } };
+
+    template <int W, int H>
+    void DrawGrid(eng::Renderer& r) {
+        for (int y = 0; y < H; ++y) for (int x = 0; x < W; ++x) {
+            float cx = r.left + (x + 0.5f) * r.cellW;
+            float cy = r.bottom + (y + 0.5f) * r.cellH;
+            r.Quad(cx, cy, r.cellW, r.cellH, { 0.12f,0.12f,0.16f });
+        }
+    }
+
+    template <int W, int H>
+    void DrawBoard(eng::Renderer& r, const BasicGame<W, H>& g) {
+        for (int y = 0; y < H; ++y) for (int x = 0; x < W; ++x) {
+            if (!((g.row(y) >> x) & 1)) continue;
+            int col = cellColor(g, x, y);
+            const auto& c = COLORS[col];
+            float cx = r.left + (x + 0.5f) * r.cellW;
+            float cy = r.bottom + (y + 0.5f) * r.cellH;
+            r.Quad(cx, cy, r.cellW, r.cellH, { c[0],c[1],c[2] });
+        }
+    }
+
+    template <int W, int H>
+    void DrawActive(eng::Renderer& r, const BasicGame<W, H>& g) {
+        const Cell* pc = PIECES[g.cur.type].rot[g.cur.r];
+        int color = PIECES[g.cur.type].colorIndex;
+        const auto& c = COLORS[color];
+        // Landing preview from the cached ghost, dimmed; skipped if the cache is stale
+        if (g.ghostOf == g.cur && g.ghostBoard == g.boardVersion && g.ghostY != g.cur.y) {
+            for (int i = 0; i < 4; ++i) {
+                int X = g.cur.x + pc[i].x, Y = g.ghostY + pc[i].y;
+                if (Y < 0 || Y >= H || X < 0 || X >= W) continue;
+                float cx = r.left + (X + 0.5f) * r.cellW;
+                float cy = r.bottom + (Y + 0.5f) * r.cellH;
+                r.Quad(cx, cy, r.cellW, r.cellH, { c[0] * 0.3f, c[1] * 0.3f, c[2] * 0.3f });
+            }
+        }
+        for (int i = 0; i < 4; ++i) {
+            const Cell& cc = pc[i];
+            int X = g.cur.x + cc.x, Y = g.cur.y + cc.y;
+            if (Y >= 0 && X >= 0 && X < W) {
+                float cx = r.left + (X + 0.5f) * r.cellW;
+                float cy = r.bottom + (Y + 0.5f) * r.cellH;
+                r.Quad(cx, cy, r.cellW, r.cellH, { c[0],c[1],c[2] });
+            }
+        }
+    }
+
+    void DrawPiecePreview(eng::Renderer& r, int type, float cx, float cy, float scale) {
+        int color = PIECES[type].colorIndex;
+        const auto& c = COLORS[color];
+        const Cell* pc = PIECES[type].rot[0];
+        for (int i = 0; i < 4; ++i) {
+            const Cell& cc = pc[i];
+            r.Quad(cx + cc.x * scale, cy + cc.y * scale, scale, scale, { c[0],c[1],c[2] });
+        }
+    }
+
+    template void DrawGrid<BOARD_W, BOARD_H>(eng::Renderer&);
+    template void DrawBoard(eng::Renderer&, const Game&);
+    template void DrawActive(eng::Renderer&, const Game&);
+    template void DrawGrid<4, BOARD_H>(eng::Renderer&);
+    template void DrawBoard(eng::Renderer&, const PracticeGame&);
+    template void DrawActive(eng::Renderer&, const PracticeGame&);
+    template void DrawGrid<40, BOARD_H>(eng::Renderer&);
+    template void DrawBoard(eng::Renderer&, const PartyGame&);
+    template void DrawActive(eng::Renderer&, const PartyGame&);
+
+} // namespace game
@@ -0,0 +1,17 @@
+#pragma once
+#include "Tetris.h"
+#include <array>
+
+namespace eng { class Renderer; }
+
+namespace game {
+
+    extern const std::array<std::array<float, 3>, 8> COLORS;
+
+    // Rendering helpers (instantiated for Game, PracticeGame and PartyGame)
+    template <int W, int H> void DrawGrid(eng::Renderer& r);
+    template <int W, int H> void DrawBoard(eng::Renderer& r, const BasicGame<W, H>& g);
+    template <int W, int H> void DrawActive(eng::Renderer& r, const BasicGame<W, H>& g);
+    void DrawPiecePreview(eng::Renderer& r, int type, float cx, float cy, float scale);
+
+} // namespace game
@@ -0,0 +1,138 @@
+#include "Replay.h"
+#include <cstdio>
+#include <cstring>
+
+namespace game {
+
+    namespace {
+        const char MAGIC[4] = { 'T', 'R', 'P', 'L' };
+        const std::uint8_t VERSION = 2; // 2: garbage holes from their own RNG
+
+        void PutU32(std::vector<std::uint8_t>& b, std::uint32_t v) { for (int i = 0; i < 4; ++i) b.push_back((std::uint8_t)(v >> (8 * i))); }
+        void PutU64(std::vector<std::uint8_t>& b, std::uint64_t v) { for (int i = 0; i < 8; ++i) b.push_back((std::uint8_t)(v >> (8 * i))); }
+        void PutVar(std::vector<std::uint8_t>& b, std::uint32_t v) {
+            while (v >= 0x80) { b.push_back((std::uint8_t)(v | 0x80)); v >>= 7; }
+            b.push_back((std::uint8_t)v);
+        }
+
+        struct Reader {
+            const std::uint8_t* p;
+            const std::uint8_t* end;
+            bool ok = true;
+
+            std::uint8_t U8() { if (p >= end) { ok = false; return 0; } return *p++; }
+            std::uint32_t U32() { std::uint32_t v = 0; for (int i = 0; i < 4; ++i) v |= (std::uint32_t)U8() << (8 * i); return v; }
+            std::uint64_t U64() { std::uint64_t v = 0; for (int i = 0; i < 8; ++i) v |= (std::uint64_t)U8() << (8 * i); return v; }
+            std::uint32_t Var() {
+                std::uint32_t v = 0;
+                for (int shift = 0; shift < 35; shift += 7) {
+                    std::uint8_t c = U8();
+                    v |= (std::uint32_t)(c & 0x7F) << shift;
+                    if (!(c & 0x80)) return v;
+                }
+                ok = false; return 0;
+            }
+        };
+    }
+
+    bool SaveReplay(const char* path, const Replay& r) {
+        std::vector<std::uint8_t> b;
+        b.reserve(32 + r.events.size() * 2);
+        b.insert(b.end(), MAGIC, MAGIC + 4);
+        b.push_back(VERSION);
+        b.push_back((std::uint8_t)r.levelIndex);
+        b.push_back((std::uint8_t)r.level);
+        b.push_back(r.instantGravity ? 1 : 0);
+        PutU64(b, r.seed);
+        PutU32(b, r.ticks);
+        PutU32(b, (std::uint32_t)r.score);
+        PutU32(b, (std::uint32_t)r.lines);
+        PutU32(b, (std::uint32_t)r.events.size());
+        std::uint32_t last = 0;
+        for (const ReplayEvent& e : r.events) { PutVar(b, e.tick - last); b.push_back(e.inputs); last = e.tick; }
+
+        std::FILE* f = std::fopen(path, "wb");
+        if (!f) { std::fprintf(stderr, "[Replay] cannot write: %s\n", path); return false; }
+        bool ok = std::fwrite(b.data(), 1, b.size(), f) == b.size();
+        ok = std::fclose(f) == 0 && ok;
+        if (!ok) std::fprintf(stderr, "[Replay] write fail: %s\n", path);
+        return ok;
+    }
+
+    bool LoadReplay(const char* path, Replay& r) {
+        std::FILE* f = std::fopen(path, "rb");
+        if (!f) { std::fprintf(stderr, "[Replay] cannot open: %s\n", path); return false; }
+        std::vector<std::uint8_t> b;
+        std::uint8_t chunk[4096];
+        for (std::size_t n; (n = std::fread(chunk, 1, sizeof(chunk), f)) > 0;) b.insert(b.end(), chunk, chunk + n);
+        std::fclose(f);
+
+        Reader in{ b.data(), b.data() + b.size() };
+        if (b.size() < 5 || std::memcmp(b.data(), MAGIC, 4) != 0 || b[4] != VERSION) {
+            std::fprintf(stderr, "[Replay] not a replay (or wrong version): %s\n", path); return false;
+        }
+        in.p += 5;
+        r = Replay{};
+        r.levelIndex = in.U8();
+        r.level = in.U8();
+        r.instantGravity = (in.U8() & 1) != 0;
+        r.seed = in.U64();
+        r.ticks = in.U32();
+        r.score = (int)in.U32();
+        r.lines = (int)in.U32();
+        std::uint32_t count = in.U32();
+        if (!in.ok || r.levelIndex > 2 || count > (std::uint32_t)(in.end - in.p) / 2) {
+            std::fprintf(stderr, "[Replay] corrupt header: %s\n", path); return false;
+        }
+        r.events.resize(count);
+        std::uint32_t tick = 0;
+        for (ReplayEvent& e : r.events) { tick += in.Var(); e.tick = tick; e.inputs = in.U8(); }
+        if (!in.ok) { std::fprintf(stderr, "[Replay] truncated: %s\n", path); return false; }
+        return true;
+    }
+
+    void ReplayRecorder::Begin(std::uint64_t seed, const Game& g) {
+        m_Replay = Replay{};
+        m_Replay.seed = seed;
+        m_Replay.levelIndex = g.levelIndex;
+        m_Replay.level = g.level;
+        m_Replay.instantGravity = g.instantGravity;
+        m_Held = 0;
+    }
+
+    void ReplayRecorder::Finish(std::uint32_t ticks, const Game& g) {
+        m_Replay.ticks = ticks;
+        m_Replay.score = g.score;
+        m_Replay.lines = g.lines;
+    }
+
+    void StartReplay(const Replay& r, Game& g, Simulation& sim) {
+        g = Game{};
+        g.levelIndex = r.levelIndex;
+        g.level = r.level;
+        g.instantGravity = r.instantGravity;
+        sim.Start(r.seed);
+    }
+
+    bool RunReplay(const Replay& r, Game& g) {
+        Simulation sim{ g };
+        StartReplay(r, g, sim);
+        std::uint8_t held = 0;
+        std::uint32_t tick = 0;
+        for (const ReplayEvent& e : r.events) {
+            if (e.tick >= r.ticks) break;
+            sim.Advance(held, e.tick - tick);
+            tick = e.tick; held = e.inputs;
+        }
+        sim.Advance(held, r.ticks - tick);
+        return g.score == r.score && g.lines == r.lines;
+    }
+
+    bool StepReplay(const Replay& r, Game& g) {
+        Simulation sim{ g };
+        StartReplay(r, g, sim);
+        for (ReplayPlayer player{ r }; !player.Done() && !g.gameOver;) sim.Step(player.Next());
+        return g.score == r.score && g.lines == r.lines;
+    }
+
+} // namespace game
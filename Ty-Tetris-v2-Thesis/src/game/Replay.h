@@ -0,0 +1,77 @@
+#pragma once
+#include "Simulation.h"
+#include <cstdint>
+#include <vector>
+
+namespace game {
+
+    // The held buttons changed to `inputs` at simulation tick `tick`
+    struct ReplayEvent { std::uint32_t tick; std::uint8_t inputs; };
+
+    // Everything needed to re-simulate a standard game, plus the result it reached
+    struct Replay {
+        std::uint64_t seed = 0;
+        int levelIndex = 0, level = 1;
+        bool instantGravity = false;
+        std::vector<ReplayEvent> events;
+        std::uint32_t ticks = 0; // ticks simulated
+        int score = 0, lines = 0;
+    };
+
+    // Compact binary file, little-endian. A 32-byte header: "TRPL", format version (u8), level
+    // index, level, 20G flag (u8 each), seed (u64), ticks, score, lines, event count (u32 each);
+    // then (varint tick delta, inputs) per event. Files of another version are rejected: the
+    // same inputs need not play out the same under other rules.
+    bool SaveReplay(const char* path, const Replay& r);
+    bool LoadReplay(const char* path, Replay& r);
+
+    // Captures the inputs of every tick the game is stepped with; only changes are stored
+    class ReplayRecorder {
+    public:
+        void Begin(std::uint64_t seed, const Game& g);
+        void Record(std::uint32_t tick, std::uint8_t inputs) {
+            if (inputs == m_Held) return;
+            m_Replay.events.push_back({ tick, inputs });
+            m_Held = inputs;
+        }
+        void Finish(std::uint32_t ticks, const Game& g);
+
+        const Replay& Get() const { return m_Replay; }
+
+    private:
+        Replay m_Replay;
+        std::uint8_t m_Held = 0;
+    };
+
+    // Feeds a replay back one tick at a time, e.g. for real-time playback
+    class ReplayPlayer {
+    public:
+        explicit ReplayPlayer(const Replay& r) : m_Replay(&r) {}
+
+        bool Done() const { return m_Tick >= m_Replay->ticks; }
+        std::uint8_t Next() {
+            while (m_Next < m_Replay->events.size() && m_Replay->events[m_Next].tick <= m_Tick)
+                m_Held = m_Replay->events[m_Next++].inputs;
+            ++m_Tick;
+            return m_Held;
+        }
+
+    private:
+        const Replay* m_Replay;
+        std::uint32_t m_Tick = 0;
+        std::size_t m_Next = 0;
+        std::uint8_t m_Held = 0;
+    };
+
+    // Reset `g` and start its simulation the way the replay's game started
+    void StartReplay(const Replay& r, Game& g, Simulation& sim);
+
+    // Re-simulate a whole replay headless, fast-forwarding between input changes.
+    // Returns true when the final score and lines match the recording.
+    bool RunReplay(const Replay& r, Game& g);
+
+    // The same, one Step per tick as the live game does it (ReplayPlayer's inputs), without
+    // the fast-forward. Must end on the same game as RunReplay.
+    bool StepReplay(const Replay& r, Game& g);
+
+} // namespace game
@@ -0,0 +1,135 @@
+#pragma once
+#include "Tetris.h"
+
+namespace game {
+
+    // Buttons held during one tick, one bit each
+    enum Input : std::uint8_t {
+        INPUT_LEFT = 1 << 0,
+        INPUT_RIGHT = 1 << 1,
+        INPUT_ROTATE_CW = 1 << 2,
+        INPUT_ROTATE_CCW = 1 << 3,
+        INPUT_SOFT_DROP = 1 << 4,
+        INPUT_HARD_DROP = 1 << 5,
+    };
+
+    static constexpr int PREVIEW_COUNT = 5;
+    static constexpr std::uint64_t GARBAGE_SEED_SALT = 0x6A09E667F3BCC909ull; // garbage RNG: game seed ^ salt
+    static constexpr int DAS_TICKS = TICK_HZ / 6;           // delayed auto-shift: ~167 ms before left/right repeats
+    static constexpr int ARR_TICKS = TICK_HZ / 30;          // auto-repeat rate: one column every ~33 ms after that
+    static constexpr int GRAVITY_LEVELS = 30;               // gravity stops speeding up past this level
+    static constexpr std::uint32_t GRAVITY_ONE = 1u << 16;  // gravity is in rows per tick, 16.16 fixed point
+
+    // Gravity per (levelIndex, level - 1): the row interval is 1 / 1.25^(level - 1) seconds,
+    // scaled by 0.6 on medium and 0.35 on hard. Evaluated once at compile time.
+    constexpr std::array<std::array<std::uint32_t, GRAVITY_LEVELS>, 3> BuildGravityTable() {
+        std::array<std::array<std::uint32_t, GRAVITY_LEVELS>, 3> t{};
+        const double scale[3] = { 1.0, 0.6, 0.35 };
+        for (int m = 0; m < 3; ++m) {
+            double rowsPerSec = 1.0;
+            for (int l = 0; l < GRAVITY_LEVELS; ++l, rowsPerSec *= 1.25)
+                t[m][l] = (std::uint32_t)(GRAVITY_ONE * rowsPerSec / (scale[m] * TICK_HZ) + 0.5);
+        }
+        return t;
+    }
+
+    inline constexpr auto GRAVITY = BuildGravityTable();
+    static constexpr std::uint32_t SOFT_DROP_GRAVITY = GRAVITY_ONE * 20 / TICK_HZ; // 20 rows/s
+
+    // Advances a game by whole ticks of 1 / TICK_HZ seconds. Everything is integer, so the
+    // same seed and the same per-tick inputs always give the same game.
+    template <int W, int H>
+    class BasicSimulation {
+    public:
+        explicit BasicSimulation(BasicGame<W, H>& g) : m_Game(&g) {}
+
+        // Deal a fresh queue from `seed`, lay the level's obstructions and spawn the first piece.
+        // Level, levelIndex and settings are taken from the game as they are.
+        void Start(std::uint64_t seed) {
+            BasicGame<W, H>& g = *m_Game;
+            g.bag.seed(seed);
+            g.garbageRng.seed(seed ^ GARBAGE_SEED_SALT);
+            g.bag.refill(PREVIEW_COUNT);
+            SeedObstructions(g, g.levelIndex);
+            spawn(g);
+            refreshGhost(g);
+            m_Tick = 0; m_Gravity = 0; m_Held = 0; m_Dir = 0; m_MoveTicks = 0;
+        }
+
+        void Step(std::uint8_t inputs) {
+            BasicGame<W, H>& g = *m_Game;
+            if (g.paused || g.gameOver) { m_Held = inputs; return; }
+            ++m_Tick;
+            std::uint8_t pressed = inputs & ~m_Held;
+            m_Held = inputs;
+
+            if (pressed & INPUT_ROTATE_CW) rotate(g, +1);
+            if (pressed & INPUT_ROTATE_CCW) rotate(g, -1);
+
+            // Left/right: the most recent press wins; move at once, then DAS, then every ARR ticks.
+            // Presses within one tick are unordered, so both at once count as left, then right.
+            int dir = m_Dir;
+            if (pressed & INPUT_LEFT) dir = -1;
+            if (pressed & INPUT_RIGHT) dir = +1;
+            if (dir < 0 && !(inputs & INPUT_LEFT)) dir = (inputs & INPUT_RIGHT) ? +1 : 0;
+            if (dir > 0 && !(inputs & INPUT_RIGHT)) dir = (inputs & INPUT_LEFT) ? -1 : 0;
+            if (dir != m_Dir) { m_Dir = dir; m_MoveTicks = 0; }
+            if (dir) {
+                int held = m_MoveTicks++;
+                if (held == 0 || (held >= DAS_TICKS && (held - DAS_TICKS) % ARR_TICKS == 0)) tryMove(g, dir, 0);
+            }
+
+            if (pressed & INPUT_HARD_DROP) {
+                hardDrop(g); lockPiece(g); clearLines(g); spawn(g);
+                if (g.gameOver) return;
+            }
+
+            m_Gravity += gravity(inputs);
+            int steps = (int)(m_Gravity >> 16);
+            m_Gravity &= GRAVITY_ONE - 1;
+            applyGravity(g, steps);
+
+            if (!g.gameOver) MaybeAddGarbage(g, 1);
+            refreshGhost(g);
+        }
+
+        // `ticks` steps with the same buttons held. Idle stretches (nothing newly pressed or
+        // repeating, no row due to fall, no garbage due) are skipped in one go; the result is
+        // the same as stepping tick by tick.
+        void Advance(std::uint8_t inputs, std::uint64_t ticks) {
+            BasicGame<W, H>& g = *m_Game;
+            while (ticks > 0 && !g.paused && !g.gameOver) {
+                bool settled = !g.instantGravity || dropDistance(g, g.cur) == 0; // 20G drops on every tick
+                if (inputs == m_Held && !(inputs & (INPUT_LEFT | INPUT_RIGHT)) && settled) {
+                    std::uint32_t gv = gravity(inputs);
+                    std::uint64_t idle = std::min<std::uint64_t>(ticks, (GRAVITY_ONE - 1 - m_Gravity) / gv);
+                    idle = std::min<std::uint64_t>(idle, (std::uint64_t)std::max(0, garbageInterval(g.levelIndex) - 1 - g.garbageTicks));
+                    m_Tick += idle; m_Gravity += (std::uint32_t)idle * gv; g.garbageTicks += (int)idle;
+                    m_Dir = 0; m_MoveTicks = 0;
+                    ticks -= idle;
+                    if (ticks == 0) break;
+                }
+                Step(inputs); --ticks;
+            }
+        }
+
+        std::uint64_t Tick() const { return m_Tick; }
+
+    private:
+        std::uint32_t gravity(std::uint8_t inputs) const {
+            const BasicGame<W, H>& g = *m_Game;
+            std::uint32_t gv = GRAVITY[g.levelIndex][std::min(g.level, GRAVITY_LEVELS) - 1];
+            return (inputs & INPUT_SOFT_DROP) && gv < SOFT_DROP_GRAVITY ? SOFT_DROP_GRAVITY : gv;
+        }
+
+        BasicGame<W, H>* m_Game;
+        std::uint64_t m_Tick = 0;     // ticks simulated while running
+        std::uint32_t m_Gravity = 0;  // fractional rows carried to the next tick
+        std::uint8_t m_Held = 0;      // inputs of the previous tick, for press edges
+        int m_Dir = 0;                // -1, 0, +1: direction left/right is shifting in
+        int m_MoveTicks = 0;          // ticks that direction has been held
+    };
+
+    using Simulation = BasicSimulation<BOARD_W, BOARD_H>;
+
+} // namespace game
@@ -0,0 +1,91 @@
+#pragma once
+#include "Tetris.h"
+#include <cstring>
+
+namespace game {
+
+    // Everything the rules need to continue a game, in one trivially-copyable block.
+    // UI state (scene, menu, player name, music) is not part of a snapshot.
+    template <int W, int H>
+    struct BasicSnapshot {
+        using Row = RowBits<W>;
+        static constexpr int PIECE_SLOTS = 7 + Bag7::QUEUE_CAP; // bag then queue, two per byte
+
+        Row rows[H];
+        Row colorPlanes[H][COLOR_PLANES];
+        Tally<H> heights[W];
+        Tally<H> colFill[W]; // per-row fill is a popcount of the row, rebuilt by Restore
+        Rng rng, garbageRng;
+        std::int32_t score, lines;
+        std::int16_t level, holes, garbageTicks;
+        Tally<H> curY, deepestWell;
+        std::int8_t curX, curR, curType, wellColumn;
+        std::uint8_t bagCount, queueCount;
+        std::uint8_t pieces[(PIECE_SLOTS + 1) / 2];
+        std::uint8_t flags; // bit 0 gameOver, 1 paused, 2 instantGravity, 4..5 levelIndex
+    };
+
+    using GameSnapshot = BasicSnapshot<BOARD_W, BOARD_H>;
+    static_assert(std::is_trivially_copyable_v<GameSnapshot>);
+    static_assert(sizeof(GameSnapshot) < 256, "standard snapshot should stay under 256 bytes");
+
+    template <int W, int H>
+    void Save(const BasicGame<W, H>& g, BasicSnapshot<W, H>& s) {
+        // Board rows are stored from row 0 up, whatever the game's ring base: at most two runs
+        int first = std::min(H, BasicGame<W, H>::ROW_SLOTS - g.rowBase), rest = H - first;
+        std::memcpy(s.rows, g.rowSlots + g.rowBase, sizeof s.rows[0] * first);
+        std::memcpy(s.rows + first, g.rowSlots, sizeof s.rows[0] * rest);
+        std::memcpy(s.colorPlanes, g.planeSlots + g.rowBase, sizeof s.colorPlanes[0] * first);
+        std::memcpy(s.colorPlanes + first, g.planeSlots, sizeof s.colorPlanes[0] * rest);
+        std::memcpy(s.heights, g.heights, sizeof s.heights);
+        std::memcpy(s.colFill, g.colFill, sizeof s.colFill);
+        s.rng = g.bag.rng;
+        s.garbageRng = g.garbageRng;
+        s.score = g.score; s.lines = g.lines;
+        s.level = (std::int16_t)g.level; s.holes = (std::int16_t)g.holes;
+        s.garbageTicks = (std::int16_t)g.garbageTicks;
+        s.curX = (std::int8_t)g.cur.x; s.curY = (Tally<H>)g.cur.y;
+        s.curR = (std::int8_t)g.cur.r; s.curType = (std::int8_t)g.cur.type;
+        s.deepestWell = (Tally<H>)g.deepestWell; s.wellColumn = (std::int8_t)g.wellColumn;
+        s.bagCount = (std::uint8_t)g.bag.bagCount; s.queueCount = (std::uint8_t)g.bag.queueCount;
+        std::uint8_t nib[2 * sizeof s.pieces] = {};
+        for (int i = 0; i < g.bag.bagCount; ++i) nib[i] = (std::uint8_t)g.bag.bag[i];
+        for (int i = 0; i < g.bag.queueCount; ++i) nib[7 + i] = (std::uint8_t)g.bag.peek(i);
+        for (int i = 0; i < (int)sizeof s.pieces; ++i) s.pieces[i] = (std::uint8_t)(nib[2 * i] | nib[2 * i + 1] << 4);
+        s.flags = (std::uint8_t)(g.gameOver | g.paused << 1 | g.instantGravity << 2 | (g.levelIndex & 3) << 4);
+    }
+
+    template <int W, int H>
+    void Restore(BasicGame<W, H>& g, const BasicSnapshot<W, H>& s) {
+        g.rowBase = 0;
+        std::memcpy(g.rowSlots, s.rows, sizeof s.rows);
+        std::memcpy(g.planeSlots, s.colorPlanes, sizeof s.colorPlanes);
+        for (int y = 0; y < H; ++y) g.fillSlots[y] = (Tally<W>)std::popcount(s.rows[y]);
+        constexpr int SPARE = BasicGame<W, H>::ROW_SLOTS - H;
+        if constexpr (SPARE > 0) {
+            std::memset(g.rowSlots + H, 0, sizeof g.rowSlots[0] * SPARE);
+            std::memset(g.planeSlots + H, 0, sizeof g.planeSlots[0] * SPARE);
+            std::memset(g.fillSlots + H, 0, sizeof g.fillSlots[0] * SPARE);
+        }
+        std::memcpy(g.heights, s.heights, sizeof s.heights);
+        std::memcpy(g.colFill, s.colFill, sizeof s.colFill);
+        g.bag.rng = s.rng;
+        g.garbageRng = s.garbageRng;
+        g.score = s.score; g.lines = s.lines;
+        g.level = s.level; g.holes = s.holes;
+        g.garbageTicks = s.garbageTicks;
+        g.cur = { s.curX, s.curY, s.curR, s.curType };
+        g.deepestWell = s.deepestWell; g.wellColumn = s.wellColumn;
+        g.bag.bagCount = s.bagCount; g.bag.queueHead = 0; g.bag.queueCount = s.queueCount;
+        for (int i = 0; i < s.bagCount; ++i) g.bag.bag[i] = (std::int8_t)(s.pieces[i >> 1] >> (i & 1) * 4 & 15);
+        for (int i = 0; i < s.queueCount; ++i) {
+            int j = 7 + i;
+            g.bag.queue[i] = (std::int8_t)(s.pieces[j >> 1] >> (j & 1) * 4 & 15);
+        }
+        g.gameOver = s.flags & 1; g.paused = s.flags >> 1 & 1; g.instantGravity = s.flags >> 2 & 1;
+        g.levelIndex = s.flags >> 4 & 3;
+        g.boardHash = detail::rowsHash(g, 0, detail::stackTop(g)); // rows above the stack are empty
+        ++g.boardVersion;
+    }
+
+} // namespace game
@@ -1,71 +1,761 @@
 #pragma once
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
 #include <vector>
 #include <random>
 #include <string>
+#include <type_traits>
 
-namespace eng { class Renderer; }
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
 namespace game {
 
+    // Standard board
     static constexpr int BOARD_W = 10;
     static constexpr int BOARD_H = 20;
     static constexpr int LINES_PER_LEVEL = 10;
+    static constexpr int TICK_HZ = 240; // fixed simulation rate
+
+    // Row storage picked from the board width: one bit per column, bit x = column x
+    template <int W>
+    using RowBits = std::conditional_t<(W <= 8), std::uint8_t,
+                    std::conditional_t<(W <= 16), std::uint16_t,
+                    std::conditional_t<(W <= 32), std::uint32_t, std::uint64_t>>>;
+
+    // Smallest signed counter that can hold 0..N
+    template <int N>
+    using Tally = std::conditional_t<(N < 128), std::int8_t, std::int16_t>;
+
+    static constexpr int COLOR_PLANES = 3; // color indices 0..7
 
     struct Cell { int x, y; };
     struct Piece { Cell rot[4][4]; int colorIndex; };
 
-    extern const Piece PIECES[7];
-    extern const std::array<std::array<float, 3>, 8> COLORS;
+    // Spawn orientation of each piece, y up, with the rotation centre in half cells (SRS):
+    // I turns about the centre of its 4x4 box, O about the centre of the square, the rest
+    // about cell (0, 0)
+    struct BaseShape { Cell cells[4]; int centerX2, centerY2; int colorIndex; };
+
+    inline constexpr BaseShape BASE_SHAPES[7] = {
+        { { {-1,0},{0,0},{1,0},{2,0} }, 1, -1, 1 }, // I
+        { { {0,0},{1,0},{0,1},{1,1} }, 1, 1, 2 },   // O
+        { { {-1,0},{0,0},{1,0},{0,1} }, 0, 0, 3 },  // T
+        { { {-1,0},{0,0},{0,1},{1,1} }, 0, 0, 4 },  // S
+        { { {-1,1},{0,1},{0,0},{1,0} }, 0, 0, 5 },  // Z
+        { { {-1,0},{0,0},{1,0},{-1,1} }, 0, 0, 6 }, // J
+        { { {-1,0},{0,0},{1,0},{1,1} }, 0, 0, 7 }   // L
+    };
+
+    // Rotation states 0, R, 2, L: each is the previous one turned clockwise about the centre
+    constexpr std::array<Piece, 7> BuildPieces() {
+        std::array<Piece, 7> t{};
+        for (int type = 0; type < 7; ++type) {
+            const BaseShape& b = BASE_SHAPES[type];
+            t[type].colorIndex = b.colorIndex;
+            for (int i = 0; i < 4; ++i) t[type].rot[0][i] = b.cells[i];
+            for (int r = 1; r < 4; ++r) for (int i = 0; i < 4; ++i) {
+                Cell c = t[type].rot[r - 1][i];
+                t[type].rot[r][i] = { (2 * c.y - b.centerY2 + b.centerX2) / 2, (b.centerX2 + b.centerY2 - 2 * c.x) / 2 };
+            }
+        }
+        return t;
+    }
+
+    inline constexpr std::array<Piece, 7> PIECES = BuildPieces();
+
+    // SRS wall kicks, y up: [I ? 1 : 0][from rotation][clockwise ? 0 : 1][test].
+    // The first test is always the unkicked rotation; O never kicks.
+    struct Kick { std::int8_t x, y; };
+    static constexpr int KICK_TESTS = 5;
+
+    inline constexpr Kick KICKS[2][4][2][KICK_TESTS] = {
+        { // J, L, S, T, Z
+            { { {0,0},{-1,0},{-1,1},{0,-2},{-1,-2} }, { {0,0},{1,0},{1,1},{0,-2},{1,-2} } },    // 0->R, 0->L
+            { { {0,0},{1,0},{1,-1},{0,2},{1,2} },     { {0,0},{1,0},{1,-1},{0,2},{1,2} } },     // R->2, R->0
+            { { {0,0},{1,0},{1,1},{0,-2},{1,-2} },    { {0,0},{-1,0},{-1,1},{0,-2},{-1,-2} } }, // 2->L, 2->R
+            { { {0,0},{-1,0},{-1,-1},{0,2},{-1,2} },  { {0,0},{-1,0},{-1,-1},{0,2},{-1,2} } }   // L->0, L->2
+        },
+        { // I
+            { { {0,0},{-2,0},{1,0},{-2,-1},{1,2} },   { {0,0},{-1,0},{2,0},{-1,2},{2,-1} } },   // 0->R, 0->L
+            { { {0,0},{-1,0},{2,0},{-1,2},{2,-1} },   { {0,0},{2,0},{-1,0},{2,1},{-1,-2} } },   // R->2, R->0
+            { { {0,0},{2,0},{-1,0},{2,1},{-1,-2} },   { {0,0},{1,0},{-2,0},{1,-2},{-2,1} } },   // 2->L, 2->R
+            { { {0,0},{1,0},{-2,0},{1,-2},{-2,1} },   { {0,0},{-2,0},{1,0},{-2,-1},{1,2} } }    // L->0, L->2
+        }
+    };
+
+    // Row-mask footprint of one (type, rotation, x) placement, built from PIECES at compile time.
+    // rows[i] holds the cells on row (y + minY + i); x is the anchor column.
+    template <int W>
+    struct PieceMask {
+        RowBits<W> rows[4];
+        std::int8_t minX, maxX, minY, maxY;
+        std::int8_t colBottom[4]; // lowest cell offset in each column minX .. maxX
+        bool inBounds; // every cell lies inside [0, W)
+    };
+
+    static constexpr int MASK_X_BIAS = 2; // anchors from -2 .. W + 1
+
+    template <int W>
+    using PieceMaskTable = std::array<std::array<std::array<PieceMask<W>, W + 2 * MASK_X_BIAS>, 4>, 7>;
 
-    struct Active { int x, y, r, type; };
+    template <int W>
+    constexpr PieceMaskTable<W> BuildPieceMasks() {
+        PieceMaskTable<W> t{};
+        for (int type = 0; type < 7; ++type) for (int r = 0; r < 4; ++r) {
+            const Cell* pc = PIECES[type].rot[r];
+            int minX = pc[0].x, maxX = pc[0].x, minY = pc[0].y, maxY = pc[0].y;
+            for (int i = 1; i < 4; ++i) {
+                minX = pc[i].x < minX ? pc[i].x : minX; maxX = pc[i].x > maxX ? pc[i].x : maxX;
+                minY = pc[i].y < minY ? pc[i].y : minY; maxY = pc[i].y > maxY ? pc[i].y : maxY;
+            }
+            for (int xi = 0; xi < W + 2 * MASK_X_BIAS; ++xi) {
+                int x = xi - MASK_X_BIAS;
+                PieceMask<W> m{};
+                m.minX = (std::int8_t)minX; m.maxX = (std::int8_t)maxX;
+                m.minY = (std::int8_t)minY; m.maxY = (std::int8_t)maxY;
+                for (int i = 0; i < 4; ++i) m.colBottom[i] = 127;
+                for (int i = 0; i < 4; ++i) {
+                    std::int8_t& b = m.colBottom[pc[i].x - minX];
+                    if (pc[i].y < b) b = (std::int8_t)pc[i].y;
+                }
+                m.inBounds = x + minX >= 0 && x + maxX < W;
+                if (m.inBounds)
+                    for (int i = 0; i < 4; ++i) m.rows[pc[i].y - minY] |= (RowBits<W>)(RowBits<W>(1) << (x + pc[i].x));
+                t[type][r][xi] = m;
+            }
+        }
+        return t;
+    }
+
+    template <int W>
+    inline constexpr PieceMaskTable<W> PIECE_MASKS = BuildPieceMasks<W>();
+
+    // nullptr when the anchor lies outside the table (always out of bounds)
+    template <int W>
+    inline const PieceMask<W>* pieceMask(int type, int r, int x) {
+        unsigned xi = (unsigned)(x + MASK_X_BIAS);
+        return xi < (unsigned)(W + 2 * MASK_X_BIAS) ? &PIECE_MASKS<W>[type][r][xi] : nullptr;
+    }
+
+    struct Active {
+        int x, y, r, type;
+        bool operator==(const Active&) const = default;
+    };
 
+    // xoshiro128**: 16 bytes of state, cheap to copy into a snapshot
+    struct Rng {
+        using result_type = std::uint32_t;
+        std::uint32_t s[4];
+
+        explicit Rng(std::uint64_t v = 0) { seed(v); }
+        void seed(std::uint64_t v) {
+            for (int i = 0; i < 4; ++i) { // splitmix64 expansion, never all zero
+                std::uint64_t z = (v += 0x9E3779B97F4A7C15ull);
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                s[i] = (std::uint32_t)((z ^ (z >> 31)) >> 16);
+            }
+        }
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return 0xFFFFFFFFu; }
+        result_type operator()() {
+            std::uint32_t r = std::rotl(s[1] * 5, 7) * 9, t = s[1] << 9;
+            s[2] ^= s[0]; s[3] ^= s[1]; s[1] ^= s[2]; s[0] ^= s[3];
+            s[2] ^= t; s[3] = std::rotl(s[3], 11);
+            return r;
+        }
+        // Uniform in [0, n): multiply-shift with rejection of the biased low products
+        std::uint32_t below(std::uint32_t n) {
+            std::uint64_t m = (std::uint64_t)(*this)() * n;
+            if ((std::uint32_t)m < n) {
+                std::uint32_t floor = (0u - n) % n;
+                while ((std::uint32_t)m < floor) m = (std::uint64_t)(*this)() * n;
+            }
+            return (std::uint32_t)(m >> 32);
+        }
+    };
+
+    // 7-bag randomizer with a ring-buffer preview. Fixed storage so a game (and its snapshot)
+    // never touches the heap; the same seed deals the same pieces on every platform.
     struct Bag7 {
-        std::vector<int> bag;
-        std::vector<int> queue;
-        std::mt19937 rng{ std::random_device{}() };
+        static constexpr int QUEUE_CAP = 16; // power of two
+        std::int8_t bag[7] = {};
+        int bagCount = 0;
+        std::int8_t queue[QUEUE_CAP] = {};
+        int queueHead = 0, queueCount = 0;
+        Rng rng{};
+
+        void seed(std::uint64_t v) { rng.seed(v); bagCount = queueHead = queueCount = 0; }
         int next();
         void refill(size_t want);
         int pull();
+        // Piece n places ahead (0 = next); past the queued pieces it is dealt on a copy
+        int peek(int n) const {
+            if (n < queueCount) return queue[(queueHead + n) & (QUEUE_CAP - 1)];
+            Bag7 ahead = *this;
+            int t = 0;
+            for (int i = queueCount; i <= n; ++i) t = ahead.next();
+            return t;
+        }
     };
 
     enum class Scene { Start, Controls, Settings, LevelSelect, Playing, GameOver, HighScores };
 
-    struct Game {
-        int board[BOARD_H][BOARD_W] = {};
-        Active cur{ 4,18,0,0 };
+    template <int W, int H>
+    struct BasicGame {
+        static_assert(W >= 4 && W <= 64, "rows are stored in at most 64 bits");
+        static_assert(H >= 4, "pieces spawn two rows below the top");
+
+        static constexpr int WIDTH = W, HEIGHT = H;
+        using Row = RowBits<W>;
+        static constexpr Row FULL_ROW = (Row)(W == 64 ? ~0ull : (1ull << W) - 1);
+
+        // Board rows live in a ring: row y is slot (rowBase + y) mod ROW_SLOTS, so garbage and
+        // line clears move the base instead of copying the board. Slots past the H board rows
+        // are always empty. Go through row()/colorPlanes()/rowFill() rather than the slots.
+        static constexpr int ROW_SLOTS = (int)std::bit_ceil((unsigned)H);
+        Row rowSlots[ROW_SLOTS] = {};                  // occupancy: bit x set when cell (x, y) is filled
+        Row planeSlots[ROW_SLOTS][COLOR_PLANES] = {}; // compact color: bit x of plane p is bit p of the color index
+        Tally<W> fillSlots[ROW_SLOTS] = {};            // filled cells per row
+        int rowBase = 0;
+
+        int slot(int y) const { return (rowBase + y) & (ROW_SLOTS - 1); }
+        Row& row(int y) { return rowSlots[slot(y)]; }
+        Row row(int y) const { return rowSlots[slot(y)]; }
+        Row* colorPlanes(int y) { return planeSlots[slot(y)]; }
+        const Row* colorPlanes(int y) const { return planeSlots[slot(y)]; }
+        Tally<W>& rowFill(int y) { return fillSlots[slot(y)]; }
+        Tally<W> rowFill(int y) const { return fillSlots[slot(y)]; }
+
+        // Board metrics, kept up to date by lockPiece/clearLines/pushGarbage/SeedObstructions
+        Tally<H> heights[W] = {}; // column surface: one past the highest filled cell
+        Tally<H> colFill[W] = {}; // filled cells per column
+        int holes = 0;            // empty cells below their column's surface
+        int deepestWell = 0, wellColumn = 0;
+        std::uint32_t boardVersion = 0; // bumped whenever cells change
+        std::uint64_t boardHash = 0;    // Zobrist-style key of the occupancy, see detail::rowKey
+        Active cur{ W / 2 - 1, H - 2, 0, 0 };
+
+        // Landing row of the active piece for the renderer, kept by refreshGhost. Valid while
+        // ghostOf == cur and ghostBoard == boardVersion.
+        int ghostY = 0;
+        Active ghostOf{ -1, -1, -1, -1 };
+        std::uint32_t ghostBoard = 0;
         Bag7 bag{};
         bool paused = false, gameOver = false;
         int score = 0, lines = 0, level = 1;
         int levelIndex = 0;
         bool musicOn = true;
+        bool instantGravity = false; // 20G: the active piece always sits on the surface
 
         Scene scene = Scene::Start;
         int menuIndex = 0;
 
-        // Obstructions
-        int garbageTimerMs = 0;
+        // Obstructions. Garbage holes have their own RNG so the piece sequence of a seed does
+        // not depend on when garbage arrives.
+        int garbageTicks = 0;
+        Rng garbageRng{};
 
         // Player name for DB
         std::string playerName = "Player";
     };
 
-    bool collides(const Game& g, const Active& a);
-    void lockPiece(Game& g);
-    int  clearLines(Game& g);
-    void spawn(Game& g);
-    bool tryMove(Game& g, int dx, int dy);
-    void rotate(Game& g, int dir);
-    void hardDrop(Game& g);
+    using Game = BasicGame<BOARD_W, BOARD_H>;
+    using PracticeGame = BasicGame<4, BOARD_H>;
+    using PartyGame = BasicGame<40, BOARD_H>;
+    using StressGame = BasicGame<BOARD_W, 400>; // tall board for garbage stress runs
+
+    // Standard-board shorthands
+    using RowMask = Game::Row;
+    static constexpr RowMask FULL_ROW = Game::FULL_ROW;
+
+    // Set of board rows, one bit per row
+    template <int H>
+    struct RowSet {
+        static constexpr int WORDS = (H + 63) / 64;
+        std::uint64_t w[WORDS] = {};
+
+        void set(int y) { w[y >> 6] |= 1ull << (y & 63); }
+        bool test(int y) const { return (w[y >> 6] >> (y & 63)) & 1; }
+        bool any() const { for (auto v : w) if (v) return true; return false; }
+        int count() const { int n = 0; for (auto v : w) n += std::popcount(v); return n; }
+        int lowest() const {
+            for (int i = 0; i < WORDS; ++i) if (w[i]) return i * 64 + std::countr_zero(w[i]);
+            return H;
+        }
+        // OR in bits 0..63 of `bits` as rows y, y + 1, ...
+        void setBits(int y, std::uint64_t bits) {
+            w[y >> 6] |= bits << (y & 63);
+            if ((y & 63) && (y >> 6) + 1 < WORDS) w[(y >> 6) + 1] |= bits >> (64 - (y & 63));
+        }
+        int highest() const {
+            for (int i = WORDS - 1; i >= 0; --i) if (w[i]) return i * 64 + 63 - std::countl_zero(w[i]);
+            return -1;
+        }
+        // Members strictly below row y
+        int countBelow(int y) const {
+            int n = 0;
+            for (int i = 0; i < (y >> 6); ++i) n += std::popcount(w[i]);
+            if (y & 63) n += std::popcount(w[y >> 6] & ((1ull << (y & 63)) - 1));
+            return n;
+        }
+    };
+
+    namespace detail {
+
+        // Board hashing: row y with occupancy `bits` contributes rowKey(y, bits) and the board
+        // key is the XOR of all rows. The row's position only rotates its key, so a board that
+        // moves up or down k rows as a whole just rotates its key by k. Empty rows add nothing.
+        inline std::uint64_t mixBits(std::uint64_t x) {
+            x *= 0x9E3779B97F4A7C15ull;
+            x ^= x >> 32;
+            x *= 0xD6E8FEB86659FD93ull;
+            return x ^ (x >> 32);
+        }
+
+        inline std::uint64_t rowKey(int y, std::uint64_t bits) {
+            return bits ? std::rotl(mixBits(bits), y) : 0;
+        }
+
+        template <int W, int H>
+        std::uint64_t rowsHash(const BasicGame<W, H>& g, int from, int to) {
+            std::uint64_t h = 0;
+            for (int y = from; y < to; ++y) h ^= rowKey(y, g.row(y));
+            return h;
+        }
 
-    // Rendering helpers
-    void DrawGrid(eng::Renderer& r);
-    void DrawBoard(eng::Renderer& r, const Game& g);
-    void DrawActive(eng::Renderer& r, const Game& g);
-    void DrawPiecePreview(eng::Renderer& r, int type, float cx, float cy, float scale);
+        template <int W, int H>
+        int stackTop(const BasicGame<W, H>& g) {
+            int top = 0;
+            for (int x = 0; x < W; ++x) top = std::max(top, (int)g.heights[x]);
+            return top;
+        }
+
+        template <int W, int H>
+        void copyRow(BasicGame<W, H>& g, int dst, int src) {
+            g.row(dst) = g.row(src);
+            g.rowFill(dst) = g.rowFill(src);
+            for (int p = 0; p < COLOR_PLANES; ++p) g.colorPlanes(dst)[p] = g.colorPlanes(src)[p];
+        }
+
+        template <int W, int H>
+        void clearRow(BasicGame<W, H>& g, int y) {
+            g.row(y) = 0;
+            g.rowFill(y) = 0;
+            for (int p = 0; p < COLOR_PLANES; ++p) g.colorPlanes(y)[p] = 0;
+        }
+
+        // Deepest well from the heights alone; walls count as infinitely tall
+        template <int W, int H>
+        int deepestWell(const Tally<H>* heights, int& column) {
+            int best = 0; column = 0;
+            for (int x = 0; x < W; ++x) {
+                int l = x > 0 ? heights[x - 1] : H;
+                int r = x < W - 1 ? heights[x + 1] : H;
+                int d = std::min(l, r) - heights[x];
+                if (d > best) { best = d; column = x; }
+            }
+            return best;
+        }
+
+        template <int W, int H>
+        void updateWells(BasicGame<W, H>& g) { g.deepestWell = deepestWell<W, H>(g.heights, g.wellColumn); }
+
+        template <int W, int H>
+        void updateHoles(BasicGame<W, H>& g) {
+            int holes = 0;
+            for (int x = 0; x < W; ++x) holes += g.heights[x] - g.colFill[x];
+            g.holes = holes;
+        }
+
+        // Walk down from the top; the first row a column shows up in is its surface
+        template <int W, int H>
+        void recomputeHeights(BasicGame<W, H>& g) {
+            using Row = typename BasicGame<W, H>::Row;
+            constexpr Row FULL = BasicGame<W, H>::FULL_ROW;
+            Row seen = 0;
+            for (int y = H - 1; y >= 0 && seen != FULL; --y) {
+                Row fresh = g.row(y) & (Row)~seen;
+                for (; fresh; fresh &= (Row)(fresh - 1)) g.heights[std::countr_zero(fresh)] = (Tally<H>)(y + 1);
+                seen |= g.row(y);
+            }
+            for (Row empty = (Row)(FULL & ~seen); empty; empty &= (Row)(empty - 1))
+                g.heights[std::countr_zero(empty)] = 0;
+        }
+
+        // Highest filled cell of column x at or below row `from`, plus one
+        template <int W, int H>
+        int surfaceBelow(const BasicGame<W, H>& g, int x, int from) {
+            for (int y = from; y >= 0; --y) if ((g.row(y) >> x) & 1) return y + 1;
+            return 0;
+        }
+
+    } // namespace detail
+
+    // Board cells. setCell writes the raw planes only; call recomputeMetrics after a batch of edits.
+    template <int W, int H>
+    int cellColor(const BasicGame<W, H>& g, int x, int y) {
+        const auto* pl = g.colorPlanes(y);
+        int c = 0;
+        for (int p = 0; p < COLOR_PLANES; ++p) c |= (int)((pl[p] >> x) & 1) << p;
+        return c;
+    }
+
+    template <int W, int H>
+    void setCell(BasicGame<W, H>& g, int x, int y, int color) {
+        using Row = typename BasicGame<W, H>::Row;
+        Row bit = (Row)(Row(1) << x);
+        Row* pl = g.colorPlanes(y);
+        if (color) g.row(y) |= bit; else g.row(y) &= (Row)~bit;
+        for (int p = 0; p < COLOR_PLANES; ++p) {
+            if ((color >> p) & 1) pl[p] |= bit;
+            else pl[p] &= (Row)~bit;
+        }
+    }
+
+    // Every filled cell has a non-zero color, so the occupancy row must equal the OR of its planes;
+    // ring slots outside the board must be empty
+    template <int W, int H>
+    bool boardConsistent(const BasicGame<W, H>& g) {
+        using Row = typename BasicGame<W, H>::Row;
+        for (int y = 0; y < H; ++y) {
+            Row any = 0;
+            for (int p = 0; p < COLOR_PLANES; ++p) any |= g.colorPlanes(y)[p];
+            if (any != g.row(y) || (g.row(y) & (Row)~BasicGame<W, H>::FULL_ROW)) return false;
+        }
+        for (int y = H; y < BasicGame<W, H>::ROW_SLOTS; ++y) {
+            Row any = g.row(y) | (Row)g.rowFill(y);
+            for (int p = 0; p < COLOR_PLANES; ++p) any |= g.colorPlanes(y)[p];
+            if (any) return false;
+        }
+        return true;
+    }
+
+    template <int W, int H>
+    void recomputeMetrics(BasicGame<W, H>& g) {
+        using Row = typename BasicGame<W, H>::Row;
+        for (int x = 0; x < W; ++x) g.colFill[x] = 0;
+        for (int y = 0; y < H; ++y) {
+            g.rowFill(y) = (Tally<W>)std::popcount(g.row(y));
+            for (Row m = g.row(y); m; m &= (Row)(m - 1)) ++g.colFill[std::countr_zero(m)];
+        }
+        detail::recomputeHeights(g);
+        detail::updateHoles(g);
+        detail::updateWells(g);
+        g.boardHash = detail::rowsHash(g, 0, H);
+        ++g.boardVersion;
+    }
+
+    // Full cell-by-cell rescan, for debug validation of the incremental metrics
+    template <int W, int H>
+    bool metricsConsistent(const BasicGame<W, H>& g) {
+        Tally<H> heights[W] = {}, colFill[W] = {};
+        int holes = 0;
+        for (int y = 0; y < H; ++y) {
+            int fill = 0;
+            for (int x = 0; x < W; ++x) {
+                if (!((g.row(y) >> x) & 1)) continue;
+                ++fill; ++colFill[x];
+                heights[x] = (Tally<H>)(y + 1);
+            }
+            if (fill != g.rowFill(y)) return false;
+        }
+        for (int x = 0; x < W; ++x) {
+            if (heights[x] != g.heights[x] || colFill[x] != g.colFill[x]) return false;
+            holes += heights[x] - colFill[x];
+        }
+        int column = 0, well = detail::deepestWell<W, H>(heights, column);
+        return holes == g.holes && well == g.deepestWell && column == g.wellColumn
+            && g.boardHash == detail::rowsHash(g, 0, H);
+    }
+
+    template <int W, int H>
+    bool collides(const BasicGame<W, H>& g, const Active& a) {
+        const PieceMask<W>* m = pieceMask<W>(a.type, a.r, a.x);
+        if (!m || !m->inBounds) return true;
+        int y0 = a.y + m->minY;
+        if (y0 < 0) return true;
+        int top = std::min(a.y + m->maxY, H - 1);
+        for (int y = y0; y <= top; ++y) if (g.row(y) & m->rows[y - y0]) return true;
+        return false;
+    }
+
+    template <int W, int H>
+    void lockPiece(BasicGame<W, H>& g) {
+        using Row = typename BasicGame<W, H>::Row;
+        const PieceMask<W>* m = pieceMask<W>(g.cur.type, g.cur.r, g.cur.x);
+        int color = PIECES[g.cur.type].colorIndex;
+        if (m && m->inBounds) {
+            int x0 = g.cur.x + m->minX, x1 = g.cur.x + m->maxX;
+            for (int x = x0; x <= x1; ++x) g.holes -= g.heights[x] - g.colFill[x];
+            int y0 = g.cur.y + m->minY;
+            for (int i = 0; i <= m->maxY - m->minY; ++i) {
+                int y = y0 + i;
+                if (y < 0 || y >= H) continue;
+                // Garbage may have been pushed into the piece; only count cells that were empty
+                Row fresh = m->rows[i] & (Row)~g.row(y);
+                Row* pl = g.colorPlanes(y);
+                g.boardHash ^= detail::rowKey(y, g.row(y)) ^ detail::rowKey(y, g.row(y) | m->rows[i]);
+                g.row(y) |= m->rows[i];
+                for (int p = 0; p < COLOR_PLANES; ++p) {
+                    if ((color >> p) & 1) pl[p] |= m->rows[i];
+                    else pl[p] &= (Row)~m->rows[i];
+                }
+                g.rowFill(y) = (Tally<W>)(g.rowFill(y) + std::popcount(fresh));
+                for (; fresh; fresh &= (Row)(fresh - 1)) {
+                    int x = std::countr_zero(fresh);
+                    ++g.colFill[x];
+                    if (y + 1 > g.heights[x]) g.heights[x] = (Tally<H>)(y + 1);
+                }
+            }
+            for (int x = x0; x <= x1; ++x) g.holes += g.heights[x] - g.colFill[x];
+            detail::updateWells(g);
+            ++g.boardVersion;
+        }
+        assert(boardConsistent(g) && metricsConsistent(g));
+    }
+
+    namespace detail {
+
+        // Full rows among `n` consecutive ring slots from `p`, recorded as board rows y0 ..
+        template <int W, int H>
+        void markFullRows(const RowBits<W>* p, int n, int y0, RowSet<H>& full) {
+            using Row = RowBits<W>;
+            constexpr Row FULL = BasicGame<W, H>::FULL_ROW;
+            int i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+            if constexpr (sizeof(Row) == 2) {
+                const __m128i f = _mm_set1_epi16((short)FULL);
+                for (; i + 8 <= n; i += 8) {
+                    __m128i eq = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*)(p + i)), f);
+                    full.setBits(y0 + i, (std::uint64_t)_mm_movemask_epi8(_mm_packs_epi16(eq, _mm_setzero_si128())));
+                }
+            }
+            else if constexpr (sizeof(Row) == 1) {
+                const __m128i f = _mm_set1_epi8((char)FULL);
+                for (; i + 16 <= n; i += 16) {
+                    __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + i)), f);
+                    full.setBits(y0 + i, (std::uint64_t)(unsigned)_mm_movemask_epi8(eq));
+                }
+            }
+#endif
+            for (; i < n; ++i) if (p[i] == FULL) full.set(y0 + i);
+        }
+
+    } // namespace detail
+
+    // Full rows among board rows 0 .. rows - 1 (rows above the stack can never be full)
+    template <int W, int H>
+    RowSet<H> fullRows(const BasicGame<W, H>& g, int rows = H) {
+        RowSet<H> full;
+        int first = std::min(rows, BasicGame<W, H>::ROW_SLOTS - g.rowBase); // rows before the ring wraps
+        detail::markFullRows<W, H>(g.rowSlots + g.rowBase, first, 0, full);
+        detail::markFullRows<W, H>(g.rowSlots, rows - first, first, full);
+        return full;
+    }
+
+    template <int W, int H>
+    int clearLines(BasicGame<W, H>& g) {
+        int top = detail::stackTop(g);
+        RowSet<H> full = fullRows(g, top);
+        if (!full.any()) return 0;
+        int cleared = full.count(), lo = full.lowest(), hi = full.highest();
+
+        // Stable compaction from whichever side moves fewer rows: either the rows between the
+        // lowest full row and the stack top drop into the gaps, or the rows under the highest
+        // full row climb up and the ring's base steps past the emptied bottom slots. The board
+        // key is patched for the rows that moved; rows above the highest full row only rotate.
+        if (top - lo <= hi + 1) {
+            std::uint64_t moved = detail::rowsHash(g, lo, top);
+            int dst = lo;
+            for (int y = lo + 1; y < top; ++y) {
+                if (full.test(y)) continue;
+                detail::copyRow(g, dst++, y);
+            }
+            for (int y = dst; y < top; ++y) detail::clearRow(g, y);
+            g.boardHash ^= moved ^ detail::rowsHash(g, lo, dst);
+        }
+        else {
+            std::uint64_t low = detail::rowsHash(g, 0, hi + 1), high = g.boardHash ^ low;
+            int dst = hi;
+            for (int y = hi - 1; y >= 0; --y) {
+                if (full.test(y)) continue;
+                detail::copyRow(g, dst--, y);
+            }
+            for (int y = dst; y >= 0; --y) detail::clearRow(g, y);
+            g.rowBase = g.slot(cleared);
+            g.boardHash = detail::rowsHash(g, 0, hi + 1 - cleared) ^ std::rotr(high, cleared);
+        }
+
+        // Each column loses one cell per cleared row and its surface drops by the cleared rows
+        // beneath it. Surfaces at or below the lowest cleared row stay put, surfaces above the
+        // highest drop by the full count, and only one whose top cell was cleared looks further down.
+        int heightDelta = 0;
+        for (int x = 0; x < W; ++x) g.colFill[x] = (Tally<H>)(g.colFill[x] - cleared);
+        for (int x = 0; x < W; ++x) {
+            int h = g.heights[x], nh;
+            if (h <= lo) continue;
+            if (h > hi + 1) nh = h - cleared;
+            else {
+                int below = full.countBelow(h);
+                nh = full.test(h - 1) ? detail::surfaceBelow(g, x, h - below - 1) : h - below;
+            }
+            heightDelta += nh - h;
+            g.heights[x] = (Tally<H>)nh;
+        }
+        // holes = sum(heights) - sum(colFill), and every column lost `cleared` cells
+        g.holes += heightDelta + W * cleared;
+        detail::updateWells(g);
+        ++g.boardVersion;
+
+        static const int T[5] = { 0,100,300,500,800 };
+        g.score += T[std::min(cleared, 4)] * g.level;
+        g.lines += cleared;
+        int nl = (g.lines / LINES_PER_LEVEL) + 1; if (nl > g.level) g.level = nl;
+        assert(boardConsistent(g) && metricsConsistent(g));
+        return cleared;
+    }
+
+    template <int W, int H>
+    void spawn(BasicGame<W, H>& g) {
+        g.cur.type = g.bag.pull();
+        g.cur.r = 0; g.cur.x = W / 2 - 1; g.cur.y = H - 2;
+        if (collides(g, g.cur)) g.gameOver = true;
+    }
+
+    template <int W, int H>
+    bool tryMove(BasicGame<W, H>& g, int dx, int dy) {
+        Active t = g.cur; t.x += dx; t.y += dy; if (!collides(g, t)) { g.cur = t; return true; } return false;
+    }
+
+    // SRS rotation: the unkicked position first, then the kick tests in order; the first
+    // free one wins. Returns false (piece unchanged) when every test collides.
+    template <int W, int H>
+    bool rotate(BasicGame<W, H>& g, int dir) {
+        Active t = g.cur; t.r = (t.r + (dir > 0 ? 1 : 3)) & 3;
+        if (!collides(g, t)) { g.cur = t; return true; }
+        if (t.type == 1) return false;
+        const Kick* k = KICKS[t.type == 0][g.cur.r][dir > 0 ? 0 : 1];
+        for (int i = 1; i < KICK_TESTS; ++i) {
+            Active c = t; c.x += k[i].x; c.y += k[i].y;
+            if (!collides(g, c)) { g.cur = c; return true; }
+        }
+        return false;
+    }
+
+    // Rows the piece can fall before resting. Straight off the column surface unless
+    // the piece is tucked under an overhang, where it falls back to stepping down.
+    template <int W, int H>
+    int dropDistance(const BasicGame<W, H>& g, const Active& a) {
+        const PieceMask<W>* m = pieceMask<W>(a.type, a.r, a.x);
+        int d = H + 4;
+        for (int i = 0; i <= m->maxX - m->minX; ++i) {
+            int gap = a.y + m->colBottom[i] - g.heights[a.x + m->minX + i];
+            if (gap < 0) {
+                Active t = a; d = 0;
+                for (--t.y; !collides(g, t); --t.y) ++d;
+                return d;
+            }
+            d = std::min(d, gap);
+        }
+        return d;
+    }
+
+    template <int W, int H>
+    void hardDrop(BasicGame<W, H>& g) { g.cur.y -= dropDistance(g, g.cur); }
+
+    // Bring the cached ghost up to date; it is only recomputed after the piece or the board changed
+    template <int W, int H>
+    void refreshGhost(BasicGame<W, H>& g) {
+        if (g.ghostOf == g.cur && g.ghostBoard == g.boardVersion) return;
+        g.ghostY = g.cur.y - dropDistance(g, g.cur);
+        g.ghostOf = g.cur;
+        g.ghostBoard = g.boardVersion;
+    }
+
+    // Advance gravity by `steps` rows in one go, locking (and spawning) whenever the piece
+    // lands with steps to spare. Returns true if at least one piece locked.
+    template <int W, int H>
+    bool applyGravity(BasicGame<W, H>& g, int steps) {
+        bool locked = false;
+        while (steps > 0 && !g.gameOver) {
+            int d = dropDistance(g, g.cur);
+            if (steps <= d) { g.cur.y -= steps; break; }
+            g.cur.y -= d; steps -= d + 1;
+            lockPiece(g); clearLines(g); spawn(g);
+            locked = true;
+        }
+        if (g.instantGravity && !g.gameOver) hardDrop(g);
+        return locked;
+    }
 
     // Obstructions
-    void SeedObstructions(Game& g, int levelIndex);
-    void MaybeAddGarbage(Game& g, int deltaMs);
+    template <int W, int H>
+    void SeedObstructions(BasicGame<W, H>& g, int levelIndex) {
+        int rows = (levelIndex == 0) ? 2 : (levelIndex == 1 ? 5 : 8);
+        std::mt19937 rng{ 1337u };
+        for (int y = 0; y < rows; ++y) {
+            int py = y;
+            for (int x = 0; x < W; ++x) {
+                float p = (levelIndex == 2) ? 0.35f : (levelIndex == 1 ? 0.22f : 0.12f);
+                if ((rng() % 1000) / 1000.0f < p) {
+                    setCell(g, x, py, 7);
+                }
+            }
+        }
+        recomputeMetrics(g);
+    }
+
+    inline int garbageInterval(int levelIndex) {
+        return TICK_HZ * ((levelIndex == 2) ? 8 : (levelIndex == 1 ? 12 : 18));
+    }
+
+    // Push `count` garbage rows (filled but for column `hole`) in from the bottom. Each row
+    // steps the ring's base down one slot, so the cost does not grow with the board height.
+    // Cells pushed past the ceiling are lost.
+    template <int W, int H>
+    void pushGarbage(BasicGame<W, H>& g, int count, int hole) {
+        using Row = typename BasicGame<W, H>::Row;
+        constexpr int COLOR = 5;
+        count = std::min(count, H);
+        const Row bits = (Row)(BasicGame<W, H>::FULL_ROW & ~(Row(1) << hole));
+        for (int i = 0; i < count; ++i) {
+            for (Row lost = g.row(H - 1); lost; lost &= (Row)(lost - 1)) --g.colFill[std::countr_zero(lost)];
+            g.boardHash ^= detail::rowKey(H - 1, g.row(H - 1));
+            detail::clearRow(g, H - 1);
+            g.rowBase = g.slot(-1);
+            g.boardHash = std::rotl(g.boardHash, 1) ^ detail::rowKey(0, bits);
+            g.row(0) = bits;
+            for (int p = 0; p < COLOR_PLANES; ++p) g.colorPlanes(0)[p] = (COLOR >> p) & 1 ? bits : Row(0);
+            g.rowFill(0) = (Tally<W>)(W - 1);
+        }
+
+        // Everything moves up; a column pushed into the ceiling looks down for its new top cell
+        for (int x = 0; x < W; ++x) {
+            if (x != hole) g.colFill[x] = (Tally<H>)(g.colFill[x] + count);
+            int h = g.heights[x];
+            if (h + count >= H) g.heights[x] = (Tally<H>)detail::surfaceBelow(g, x, H - 1);
+            else if (h || x != hole) g.heights[x] = (Tally<H>)(h + count);
+        }
+        detail::updateHoles(g);
+        detail::updateWells(g);
+        ++g.boardVersion;
+        assert(boardConsistent(g) && metricsConsistent(g));
+    }
+
+    // Push a garbage row in from the bottom every few seconds of simulated time
+    template <int W, int H>
+    void MaybeAddGarbage(BasicGame<W, H>& g, int ticks) {
+        g.garbageTicks += ticks;
+        if (g.garbageTicks < garbageInterval(g.levelIndex)) return;
+        g.garbageTicks = 0;
+        pushGarbage(g, 1, (int)g.garbageRng.below(W));
+    }
 
 } // namespace game
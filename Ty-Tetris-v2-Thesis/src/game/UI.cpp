@@ -3,6 +3,7 @@
 #include "../engine/Texture.h"
 #include "../engine/DB.h"
 #include "Tetris.h"
+#include "Render.h"
 #include "imgui.h"
 #include <GLFW/glfw3.h>
 #include <cstdio>
@@ -49,14 +50,15 @@ namespace ui {
             "Space      : Hard Drop\n"
             "P          : Pause\n"
             "R          : Restart\n"
+            "F1         : Autoplay On/Off\n"
             "Esc        : Pause Menu / Quit");
         if (ImGui::Button("Back")) g.scene = game::Scene::Start;
         ImGui::End();
     }
 
     void DrawSettings(game::Game& g, int fbw, int fbh, const std::function<bool(bool)>& onMusicToggle) {
-        ImGui::SetNextWindowSize(ImVec2(420, 210), ImGuiCond_Always);
-        ImGui::SetNextWindowPos(ImVec2((fbw - 420) / 2.0f, (fbh - 210) / 2.0f), ImGuiCond_Always);
+        ImGui::SetNextWindowSize(ImVec2(420, 240), ImGuiCond_Always);
+        ImGui::SetNextWindowPos(ImVec2((fbw - 420) / 2.0f, (fbh - 240) / 2.0f), ImGuiCond_Always);
         ImGui::Begin("Settings", nullptr, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoCollapse);
 
         static char nameBuf[32];
@@ -69,6 +71,7 @@ namespace ui {
             g.musicOn = m;
             if (onMusicToggle) onMusicToggle(m);
         }
+        ImGui::Checkbox("20G (instant gravity)", &g.instantGravity);
         if (ImGui::Button("Back")) g.scene = game::Scene::Start;
         ImGui::End();
     }
@@ -95,8 +98,8 @@ namespace ui {
         ImGui::Separator();
         ImGui::Text("Next:");
 
-        if (!g.bag.queue.empty()) {
-            int t = g.bag.queue[0];
+        if (g.bag.queueCount > 0) {
+            int t = g.bag.peek(0);
             const auto& c = game::COLORS[game::PIECES[t].colorIndex];
             const game::Cell* pc = game::PIECES[t].rot[0];
 
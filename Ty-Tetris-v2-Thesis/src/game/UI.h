@@ -1,10 +1,10 @@
 #pragma once
+#include "Tetris.h"
 #include <functional>
 #include <vector>
 
 struct GLFWwindow;
 namespace eng { class Renderer; class Texture2D; struct ScoreRow; }
-namespace game { struct Game; }
 
 namespace ui {
 
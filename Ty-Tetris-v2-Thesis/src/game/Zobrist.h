@@ -0,0 +1,64 @@
+#pragma once
+#include "Tetris.h"
+
+namespace game {
+
+    // Search keys built on the board hash that lockPiece/clearLines/pushGarbage keep current.
+    // The piece sequence part packs the active type, the queue in order and the set of pieces
+    // left in the bag into one word (exact, no collisions of its own) before mixing.
+
+    // Pieces the mirror image of a board plays with: S <-> Z, J <-> L, the rest map to themselves
+    inline constexpr int MIRROR_TYPE[7] = { 0, 1, 2, 4, 3, 6, 5 };
+
+    inline std::uint64_t sequenceKey(const Bag7& bag, int curType, bool mirror = false) {
+        auto t = [&](int type) { return (std::uint64_t)(mirror ? MIRROR_TYPE[type] : type); };
+        std::uint64_t k = t(curType) | (std::uint64_t)bag.queueCount << 3;
+        int n = std::min(bag.queueCount, Bag7::QUEUE_CAP - 1);
+        for (int i = 0; i < n; ++i) k |= t(bag.queue[(bag.queueHead + i) & (Bag7::QUEUE_CAP - 1)]) << (8 + 3 * i);
+        std::uint64_t left = 0;
+        for (int i = 0; i < bag.bagCount; ++i) left |= 1ull << t(bag.bag[i]);
+        return detail::mixBits(k ^ 0x5851F42D4C957F2Dull) ^ detail::mixBits(left ^ 0x14057B7EF767814Full);
+    }
+
+    inline std::uint64_t pieceKey(const Active& a) {
+        return detail::mixBits((std::uint64_t)(a.x + 64) | (std::uint64_t)a.y << 8 | (std::uint64_t)a.r << 24 | 0xA24BAED4ull << 32);
+    }
+
+    // Board, active piece (type and position) and upcoming pieces
+    template <int W, int H>
+    std::uint64_t stateKey(const BasicGame<W, H>& g) {
+        return g.boardHash ^ sequenceKey(g.bag, g.cur.type) ^ pieceKey(g.cur);
+    }
+
+    template <int W>
+    RowBits<W> mirrorRow(RowBits<W> r) {
+        std::uint64_t x = r;
+        x = (x >> 1 & 0x5555555555555555ull) | (x & 0x5555555555555555ull) << 1;
+        x = (x >> 2 & 0x3333333333333333ull) | (x & 0x3333333333333333ull) << 2;
+        x = (x >> 4 & 0x0F0F0F0F0F0F0F0Full) | (x & 0x0F0F0F0F0F0F0F0Full) << 4;
+        x = (x >> 8 & 0x00FF00FF00FF00FFull) | (x & 0x00FF00FF00FF00FFull) << 8;
+        x = (x >> 16 & 0x0000FFFF0000FFFFull) | (x & 0x0000FFFF0000FFFFull) << 16;
+        x = x >> 32 | x << 32;
+        return (RowBits<W>)(x >> (64 - W));
+    }
+
+    // Board key of the left-right mirror image, from scratch (O(stack height))
+    template <int W, int H>
+    std::uint64_t mirroredBoardHash(const BasicGame<W, H>& g) {
+        std::uint64_t h = 0;
+        for (int y = 0, top = detail::stackTop(g); y < top; ++y) h ^= detail::rowKey(y, mirrorRow<W>(g.row(y)));
+        return h;
+    }
+
+    // Key of a position whose active piece has just spawned (its position is left out). With
+    // `mirror` a board and its mirror image (playing the mirrored pieces) share the smaller key.
+    // Scores from the weighted features are symmetric, but spawn columns and SRS kicks are not,
+    // so mirrored positions are close rather than identical.
+    template <int W, int H>
+    std::uint64_t spawnKey(const BasicGame<W, H>& g, bool mirror = false) {
+        std::uint64_t k = g.boardHash ^ sequenceKey(g.bag, g.cur.type);
+        if (!mirror) return k;
+        return std::min(k, mirroredBoardHash(g) ^ sequenceKey(g.bag, g.cur.type, true));
+    }
+
+} // namespace game
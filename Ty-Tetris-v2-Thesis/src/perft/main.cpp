@@ -0,0 +1,305 @@
+// Placement perft: from a set of standard positions and a known piece queue, count what can be
+// reached placing 1..N pieces, chess-engine style. Two numbers per depth:
+//   paths    - placement sequences (every reachable lock of every piece, topped-out games end)
+//   distinct - different boards after the last piece, the same board reached by several
+//              sequences counted once
+// The expected values were recorded from these rules; any change to collides, rotate,
+// tryMove, clearLines or the move generator that shifts them shows up as a mismatch.
+// --brute generates the placements by a plain search over tryMove/rotate instead of
+// GeneratePlacements, as an independent check of the generator. Path counting is also the
+// headline throughput number for the rules core, measured on one thread and on all of them.
+#include "../engine/Scheduler.h"
+#include "../game/MoveGen.h"
+#include "../game/Snapshot.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+    using game::BOARD_W;
+    using game::BOARD_H;
+    using Board = std::array<game::RowMask, BOARD_H>;
+
+    constexpr int MAX_DEPTH = 8;
+    constexpr const char* PIECE_NAMES = "IOTSZJL"; // piece type order
+
+    struct Position {
+        const char* name;
+        void (*setup)(game::Game& g);
+        std::uint64_t paths[MAX_DEPTH + 1];    // expected, by depth (0: not recorded)
+        std::uint64_t distinct[MAX_DEPTH + 1];
+    };
+
+    void SetupEmpty(game::Game&) {}
+    void SetupObstructed(game::Game& g) { game::SeedObstructions(g, 1); }
+    void SetupGarbage(game::Game& g) {
+        game::pushGarbage(g, 2, 3);
+        game::pushGarbage(g, 1, 7);
+        game::pushGarbage(g, 2, 0);
+    }
+    void SetupTall(game::Game& g) { // a few rows from topping out
+        for (int i = 0; i < 15; ++i) game::pushGarbage(g, 1, (i * 3) % BOARD_W);
+    }
+
+    // Recorded with the default queue (both generators agree)
+    const Position POSITIONS[] = {
+        { "empty", SetupEmpty, { 0, 34, 600, 5578, 201082 }, { 0, 34, 600, 5578, 200882 } },
+        { "obstructed", SetupObstructed, { 0, 45, 986, 9405, 389366 }, { 0, 45, 986, 9405, 389310 } },
+        { "garbage", SetupGarbage, { 0, 34, 598, 5551, 199543 }, { 0, 34, 598, 5551, 199375 } },
+        { "tall", SetupTall, { 0, 34, 579, 3818, 94235 }, { 0, 34, 579, 3712, 91067 } },
+    };
+    constexpr const char* DEFAULT_QUEUE = "TIOLJSZT";
+
+    Board BoardOf(const game::Game& g) {
+        Board b;
+        for (int y = 0; y < BOARD_H; ++y) b[y] = g.row(y);
+        return b;
+    }
+
+    struct BoardHash {
+        std::size_t operator()(const Board& b) const {
+            std::uint64_t h = 0;
+            for (int y = 0; y < BOARD_H; ++y) h ^= game::detail::rowKey(y, b[y]);
+            return (std::size_t)h;
+        }
+    };
+
+    // Board with `queue` dealt in order: queue[0] is the active piece
+    bool MakeGame(const Position& p, const std::string& queue, game::Game& g) {
+        g = game::Game{};
+        p.setup(g);
+        game::recomputeMetrics(g);
+        g.bag.seed(0);
+        g.bag.queueHead = 0;
+        g.bag.queueCount = 0;
+        for (char c : queue) {
+            const char* at = std::strchr(PIECE_NAMES, c);
+            if (!c || !at || g.bag.queueCount == game::Bag7::QUEUE_CAP) return false;
+            g.bag.queue[g.bag.queueCount++] = (std::int8_t)(at - PIECE_NAMES);
+        }
+        game::spawn(g);
+        return true;
+    }
+
+    // Placement generators: GeneratePlacements, or a plain flood fill over the rules' own moves
+    struct Generator {
+        bool brute = false;
+        game::PlacementList<BOARD_W, BOARD_H> list;
+        game::Game probe, scratch;
+        std::vector<game::Active> locks;
+
+        const std::vector<game::Active>& operator()(const game::Game& g) {
+            locks.clear();
+            if (!brute) {
+                game::GeneratePlacements(g, g.cur.type, list);
+                for (int k = 0; k < list.count; ++k) locks.push_back(list[k]);
+                return locks;
+            }
+            // Every state reachable by shifts, rotations (with kicks) and soft drops; the ones
+            // that cannot move down are locks. Locks with the same cells are the same placement.
+            constexpr int XS = BOARD_W + 4, YS = BOARD_H + 4;
+            static thread_local std::vector<std::uint8_t> seen;
+            seen.assign(4 * XS * YS, 0);
+            auto index = [&](const game::Active& a) { return (a.r * XS + a.x + 2) * YS + a.y + 2; };
+            std::vector<game::Active> stack{ g.cur };
+            seen[index(g.cur)] = 1;
+            probe = g;
+            std::vector<std::array<int, 4>> footprints;
+            while (!stack.empty()) {
+                game::Active a = stack.back();
+                stack.pop_back();
+                game::Active next[5] = { a, a, a, a, a };
+                bool ok[5] = {};
+                next[0].x--; ok[0] = !game::collides(g, next[0]);
+                next[1].x++; ok[1] = !game::collides(g, next[1]);
+                next[2].y--; ok[2] = !game::collides(g, next[2]);
+                probe.cur = a; ok[3] = game::rotate(probe, 1); next[3] = probe.cur;
+                probe.cur = a; ok[4] = game::rotate(probe, -1); next[4] = probe.cur;
+                if (!ok[2]) {
+                    // The cells the piece covers, above the ceiling too, identify the placement
+                    std::array<int, 4> cells;
+                    for (int i = 0; i < 4; ++i) {
+                        const game::Cell& c = game::PIECES[a.type].rot[a.r][i];
+                        cells[i] = (a.y + c.y) * BOARD_W + a.x + c.x;
+                    }
+                    std::sort(cells.begin(), cells.end());
+                    if (std::find(footprints.begin(), footprints.end(), cells) == footprints.end()) {
+                        footprints.push_back(cells);
+                        locks.push_back(a);
+                    }
+                }
+                for (int i = 0; i < 5; ++i) {
+                    if (!ok[i] || seen[index(next[i])]) continue;
+                    seen[index(next[i])] = 1;
+                    stack.push_back(next[i]);
+                }
+            }
+            return locks;
+        }
+    };
+
+    // Lock, clear and spawn the next piece; false when that topped the game out
+    bool Play(game::Game& g, const game::Active& a) {
+        g.cur = a;
+        game::lockPiece(g);
+        game::clearLines(g);
+        game::spawn(g);
+        return !g.gameOver;
+    }
+
+    // Placement sequences of `depth` pieces: depth-first, subtrees forked onto the scheduler
+    // while they are big enough to be worth it
+    struct PathCounter {
+        eng::Scheduler& scheduler;
+        std::vector<std::unique_ptr<Generator>> gens;
+        bool brute;
+
+        PathCounter(eng::Scheduler& s, bool b) : scheduler(s), brute(b) {
+            for (int i = 0; i < s.Size(); ++i) { gens.push_back(std::make_unique<Generator>()); gens.back()->brute = b; }
+        }
+
+        std::uint64_t count(const game::GameSnapshot& s, int depth) {
+            Generator& gen = *gens[eng::Scheduler::WorkerIndex()];
+            game::Game& g = gen.scratch; // only until the children are forked
+            game::Restore(g, s);
+            const std::vector<game::Active>& generated = gen(g);
+            if (depth == 1) return generated.size(); // bulk count the last piece
+            std::vector<game::Active> locks = generated;
+            std::vector<game::GameSnapshot> kids;
+            for (const game::Active& a : locks) {
+                game::Restore(g, s);
+                if (!Play(g, a)) continue; // topped out: a path that ends here
+                kids.emplace_back();
+                game::Save(g, kids.back());
+            }
+            std::uint64_t total = locks.size() - kids.size();
+            std::vector<std::uint64_t> sub(kids.size());
+            if (depth >= 3) {
+                eng::Scheduler::TaskGroup group(scheduler);
+                for (std::size_t i = 0; i < kids.size(); ++i) {
+                    PathCounter* self = this;
+                    const game::GameSnapshot* k = &kids[i];
+                    std::uint64_t* out = &sub[i];
+                    group.Spawn([self, k, out, depth] { *out = self->count(*k, depth - 1); });
+                }
+                group.Wait();
+            }
+            else for (std::size_t i = 0; i < kids.size(); ++i) sub[i] = count(kids[i], depth - 1);
+            for (std::uint64_t n : sub) total += n;
+            return total;
+        }
+    };
+
+    // Distinct boards after each depth; a board reached several ways is expanded once
+    std::vector<std::uint64_t> CountDistinct(const game::Game& root, int depth, bool brute) {
+        Generator gen;
+        gen.brute = brute;
+        std::vector<std::uint64_t> counts;
+        std::vector<game::GameSnapshot> frontier(1), next;
+        game::Save(root, frontier[0]);
+        for (int d = 1; d <= depth; ++d) {
+            std::unordered_map<Board, int, BoardHash> seen;
+            next.clear();
+            game::Game g;
+            for (const game::GameSnapshot& s : frontier) {
+                game::Restore(g, s);
+                if (g.gameOver) continue;
+                std::vector<game::Active> locks = gen(g);
+                for (const game::Active& a : locks) {
+                    game::Restore(g, s);
+                    Play(g, a);
+                    if (!seen.emplace(BoardOf(g), (int)next.size()).second) continue;
+                    next.emplace_back();
+                    game::Save(g, next.back());
+                }
+            }
+            counts.push_back(next.size());
+            std::swap(frontier, next);
+        }
+        return counts;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int depth = 4, threads = 0;
+    bool brute = false, distinct = true;
+    std::string queue = DEFAULT_QUEUE, only;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--depth") == 0 && i + 1 < argc) depth = std::clamp(std::atoi(argv[++i]), 1, MAX_DEPTH);
+        else if (std::strcmp(argv[i], "--queue") == 0 && i + 1 < argc) queue = argv[++i];
+        else if (std::strcmp(argv[i], "--position") == 0 && i + 1 < argc) only = argv[++i];
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = std::max(0, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--brute") == 0) brute = true;
+        else if (std::strcmp(argv[i], "--no-distinct") == 0) distinct = false;
+        else {
+            std::fprintf(stderr, "usage: tetris_perft [--depth 1-%d] [--queue PIECES] [--position NAME] [--threads T]\n"
+                "                    [--brute] [--no-distinct]\n", MAX_DEPTH);
+            return 2;
+        }
+    }
+    if (depth > (int)queue.size()) {
+        std::fprintf(stderr, "queue %s has fewer than %d pieces\n", queue.c_str(), depth);
+        return 2;
+    }
+    const bool check = queue == DEFAULT_QUEUE;
+
+    int hw = (int)std::max(1u, std::thread::hardware_concurrency());
+    eng::Scheduler serial(1), parallel(threads > 0 ? threads : hw);
+    PathCounter one(serial, brute), all(parallel, brute);
+    int failures = 0;
+    std::uint64_t serialNodes = 0, parallelNodes = 0;
+    double serialSec = 0, parallelSec = 0;
+
+    std::printf("queue %s, %s generator%s\n", queue.c_str(), brute ? "brute-force" : "GeneratePlacements",
+        check ? "" : " (no recorded values for this queue)");
+    std::printf("%-11s %5s %14s %12s %12s  %s\n", "position", "depth", "paths", "distinct", "Mnodes/s", "");
+    for (const Position& p : POSITIONS) {
+        if (!only.empty() && only != p.name) continue;
+        game::Game g;
+        if (!MakeGame(p, queue, g)) { std::fprintf(stderr, "bad queue %s (pieces are %s)\n", queue.c_str(), PIECE_NAMES); return 2; }
+        game::GameSnapshot root;
+        game::Save(g, root);
+        std::vector<std::uint64_t> boards = distinct ? CountDistinct(g, depth, brute) : std::vector<std::uint64_t>();
+
+        for (int d = 1; d <= depth; ++d) {
+            std::uint64_t paths = 0;
+            auto t0 = std::chrono::steady_clock::now();
+            serial.Run([&] { paths = g.gameOver ? 0 : one.count(root, d); });
+            auto t1 = std::chrono::steady_clock::now();
+            std::uint64_t again = 0;
+            parallel.Run([&] { again = g.gameOver ? 0 : all.count(root, d); });
+            auto t2 = std::chrono::steady_clock::now();
+            double s1 = std::chrono::duration<double>(t1 - t0).count(), s2 = std::chrono::duration<double>(t2 - t1).count();
+            serialNodes += paths; serialSec += s1;
+            parallelNodes += again; parallelSec += s2;
+
+            std::string verdict;
+            if (again != paths) verdict += " THREADS DISAGREE";
+            if (check && p.paths[d] && p.paths[d] != paths) verdict += " PATHS MISMATCH (expected " + std::to_string(p.paths[d]) + ")";
+            if (check && distinct && p.distinct[d] && p.distinct[d] != boards[d - 1])
+                verdict += " DISTINCT MISMATCH (expected " + std::to_string(p.distinct[d]) + ")";
+            bool recorded = check && p.paths[d] && (!distinct || p.distinct[d]);
+            if (!verdict.empty()) ++failures;
+            else verdict = recorded ? " ok" : "";
+            std::printf("%-11s %5d %14llu %12s %12.2f %s\n", p.name, d, (unsigned long long)paths,
+                distinct ? std::to_string(boards[d - 1]).c_str() : "-", s1 > 0 ? paths / s1 * 1e-6 : 0.0, verdict.c_str());
+        }
+    }
+    std::printf("rules core: %.2f M nodes/s on 1 thread, %.2f M nodes/s on %d thread%s\n",
+        serialSec > 0 ? serialNodes / serialSec * 1e-6 : 0.0, parallelSec > 0 ? parallelNodes / parallelSec * 1e-6 : 0.0,
+        parallel.Size(), parallel.Size() == 1 ? "" : "s");
+    if (failures) std::printf("%d FAILED\n", failures);
+    return failures ? 1 : 0;
+}
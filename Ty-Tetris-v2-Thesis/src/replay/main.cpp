@@ -0,0 +1,53 @@
+// Headless replay runner: re-simulates recorded games at full speed and checks the results.
+// Each replay is also stepped tick by tick once, as the live game runs it, and must end on
+// the same board and score as the fast-forwarded run.
+#include "../game/Replay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+int main(int argc, char** argv) {
+    int repeat = 1;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = std::max(1, std::atoi(argv[++i]));
+        else files.push_back(argv[i]);
+    }
+    if (files.empty()) {
+        std::fprintf(stderr, "usage: tetris_replay [--repeat N] replay.trp...\n");
+        return 2;
+    }
+
+    std::vector<game::Replay> replays(files.size());
+    for (size_t i = 0; i < files.size(); ++i)
+        if (!game::LoadReplay(files[i], replays[i])) return 2;
+
+    int mismatches = 0;
+    std::uint64_t games = 0, ticks = 0;
+    game::Game g, stepped;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int rep = 0; rep < repeat; ++rep) {
+        for (size_t i = 0; i < replays.size(); ++i) {
+            const game::Replay& r = replays[i];
+            bool ok = game::RunReplay(r, g);
+            if (rep == 0) {
+                game::StepReplay(r, stepped);
+                bool same = stepped.boardHash == g.boardHash && stepped.score == g.score
+                    && stepped.lines == g.lines && stepped.gameOver == g.gameOver;
+                std::printf("%-32s %s  score %d (recorded %d)  lines %d (recorded %d)%s\n",
+                    files[i], ok ? "ok      " : "MISMATCH", g.score, r.score, g.lines, r.lines,
+                    same ? "" : "  STEPPING DIFFERS");
+                if (!ok || !same) ++mismatches;
+            }
+            ++games; ticks += r.ticks;
+        }
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::printf("%llu games in %.3f s: %.0f games/s, %.2f M ticks/s\n",
+        (unsigned long long)games, sec, games / sec, ticks / sec * 1e-6);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,689 @@
+// Rules tests: the bitboard rules core against a plain cell-grid reference. Random boards and
+// random piece sequences are played through collides, lockPiece, clearLines and pushGarbage
+// on both, on every board size the game uses plus a few odd ones, and after each step the
+// cells, the incremental metrics and the score must agree. Rotation is checked against the
+// guideline's own pictures and kick tables, written out here apart from PIECES and KICKS,
+// with known answers for the wall and T kicks. The placement legality maps must match collides
+// at every anchor. Snapshots must restore the game they saved. The board feature kernels (row
+// scan, column transpose, and Measure on the standard board) are checked against a cell-by-
+// cell count the same way. Recorded games with random inputs go through a replay file and
+// must end the same fast-forwarded (RunReplay) and stepped tick by tick (StepReplay) as they
+// did live. Exit status is the number of failed checks (capped), so CTest runs it as is.
+#include "../ai/Player.h"
+#include "../game/Placements.h"
+#include "../game/Replay.h"
+#include "../game/Snapshot.h"
+#include "../game/Tetris.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+    int g_Failures = 0;
+
+    // Prints the first few failures; the count is what matters after that
+    template <class... Args>
+    void Fail(const char* fmt, Args... args) {
+        if (++g_Failures <= 10) { std::printf("  FAIL "); std::printf(fmt, args...); std::printf("\n"); }
+    }
+
+    // The board as a grid of color indices, 0 = empty, with the rules written out cell by cell
+    template <int W, int H>
+    struct CellBoard {
+        std::vector<int> cells = std::vector<int>(W * H);
+        int score = 0, lines = 0, level = 1;
+
+        int& at(int x, int y) { return cells[y * W + x]; }
+        int at(int x, int y) const { return cells[y * W + x]; }
+
+        // Cells above the ceiling are allowed, like a piece spawning partly off the board
+        bool collides(const game::Active& a) const {
+            for (const game::Cell& c : game::PIECES[a.type].rot[a.r]) {
+                int x = a.x + c.x, y = a.y + c.y;
+                if (x < 0 || x >= W || y < 0) return true;
+                if (y < H && at(x, y)) return true;
+            }
+            return false;
+        }
+
+        void lock(const game::Active& a) {
+            for (const game::Cell& c : game::PIECES[a.type].rot[a.r]) {
+                int x = a.x + c.x, y = a.y + c.y;
+                if (y < H) at(x, y) = game::PIECES[a.type].colorIndex;
+            }
+        }
+
+        int clearLines() {
+            int dst = 0, cleared = 0;
+            for (int y = 0; y < H; ++y) {
+                bool full = true;
+                for (int x = 0; x < W; ++x) full = full && at(x, y);
+                if (full) { ++cleared; continue; }
+                for (int x = 0; x < W; ++x) at(x, dst) = at(x, y);
+                ++dst;
+            }
+            for (int y = dst; y < H; ++y) for (int x = 0; x < W; ++x) at(x, y) = 0;
+            static const int T[5] = { 0, 100, 300, 500, 800 };
+            if (cleared) {
+                score += T[std::min(cleared, 4)] * level;
+                lines += cleared;
+                level = std::max(level, lines / game::LINES_PER_LEVEL + 1);
+            }
+            return cleared;
+        }
+
+        void pushGarbage(int count, int hole) {
+            count = std::min(count, H);
+            for (int y = H - 1; y >= count; --y) for (int x = 0; x < W; ++x) at(x, y) = at(x, y - count);
+            for (int y = 0; y < count; ++y) for (int x = 0; x < W; ++x) at(x, y) = x == hole ? 0 : 5;
+        }
+    };
+
+    // Cells, metrics and score of the game against the reference
+    template <int W, int H>
+    bool Agree(const game::BasicGame<W, H>& g, const CellBoard<W, H>& ref, const char* name, const char* step, int n) {
+        for (int y = 0; y < H; ++y) for (int x = 0; x < W; ++x) {
+            if (game::cellColor(g, x, y) != ref.at(x, y)) {
+                Fail("%s: cell (%d, %d) after %s %d: %d, reference %d", name, x, y, step, n, game::cellColor(g, x, y), ref.at(x, y));
+                return false;
+            }
+        }
+        int holes = 0;
+        for (int x = 0; x < W; ++x) {
+            int h = 0, fill = 0;
+            for (int y = 0; y < H; ++y) if (ref.at(x, y)) { h = y + 1; ++fill; }
+            holes += h - fill;
+            if (g.heights[x] != h || g.colFill[x] != fill) {
+                Fail("%s: column %d after %s %d: height %d fill %d, reference %d %d", name, x, step, n, (int)g.heights[x], (int)g.colFill[x], h, fill);
+                return false;
+            }
+        }
+        for (int y = 0; y < H; ++y) {
+            int fill = 0;
+            for (int x = 0; x < W; ++x) fill += ref.at(x, y) != 0;
+            if (g.rowFill(y) != fill) { Fail("%s: row %d fill after %s %d: %d, reference %d", name, y, step, n, (int)g.rowFill(y), fill); return false; }
+        }
+        if (g.holes != holes) { Fail("%s: holes after %s %d: %d, reference %d", name, step, n, g.holes, holes); return false; }
+        if (g.score != ref.score || g.lines != ref.lines || g.level != ref.level) {
+            Fail("%s: score/lines/level after %s %d: %d/%d/%d, reference %d/%d/%d", name, step, n,
+                g.score, g.lines, g.level, ref.score, ref.lines, ref.level);
+            return false;
+        }
+        if (!game::boardConsistent(g) || !game::metricsConsistent(g)) { Fail("%s: inconsistent board after %s %d", name, step, n); return false; }
+        return true;
+    }
+
+    // A random stack up to `rows` high, some of its rows full
+    template <int W, int H>
+    void RandomBoard(game::BasicGame<W, H>& g, CellBoard<W, H>& ref, int rows, std::mt19937& rng) {
+        g = game::BasicGame<W, H>{};
+        ref = CellBoard<W, H>{};
+        for (int y = 0; y < rows; ++y) {
+            bool full = rng() % 8 == 0;
+            for (int x = 0; x < W; ++x) {
+                int c = full || rng() % 10 < 6 ? 1 + (int)(rng() % 7) : 0;
+                game::setCell(g, x, y, c);
+                ref.at(x, y) = c;
+            }
+        }
+        game::recomputeMetrics(g);
+    }
+
+    // `games` random boards with `pieces` random pieces each: a random column and rotation,
+    // dropped a row at a time, with the odd garbage row pushed in between
+    template <int W, int H>
+    void TestRules(const char* name, int games, int pieces, unsigned seed) {
+        std::mt19937 rng{ seed };
+        game::BasicGame<W, H> g;
+        CellBoard<W, H> ref;
+        const int before = g_Failures;
+        int locked = 0, cleared = 0;
+        for (int n = 0; n < games && g_Failures == before; ++n) {
+            RandomBoard(g, ref, (int)(rng() % (H / 2 + 1)), rng);
+            if (!Agree(g, ref, name, "board", n)) break;
+            for (int k = 0; k < pieces; ++k) {
+                // Probe positions all around and off the board, walls and floor included
+                for (int i = 0; i < 8; ++i) {
+                    game::Active a{ (int)(rng() % (W + 6)) - 3, (int)(rng() % (H + 6)) - 3, (int)(rng() % 4), (int)(rng() % 7) };
+                    if (game::collides(g, a) != ref.collides(a)) {
+                        Fail("%s: collides(x %d, y %d, r %d, type %d) on board %d: %d, reference %d", name, a.x, a.y, a.r, a.type, n,
+                            game::collides(g, a), ref.collides(a));
+                        break;
+                    }
+                }
+
+                game::Active a{ (int)(rng() % (W + 4)) - 2, H - 2, (int)(rng() % 4), (int)(rng() % 7) };
+                if (ref.collides(a)) { a.x = W / 2 - 1; a.r = 0; }
+                if (game::collides(g, a) != ref.collides(a)) { Fail("%s: collides at spawn on board %d", name, n); break; }
+                if (ref.collides(a)) break; // topped out
+                for (game::Active down = a; --down.y, !ref.collides(down); a = down) {
+                    if (game::collides(g, down)) { Fail("%s: collides on the way down on board %d", name, n); break; }
+                }
+                if (!game::collides(g, { a.x, a.y - 1, a.r, a.type })) { Fail("%s: no floor under a landed piece on board %d", name, n); break; }
+
+                g.cur = a;
+                game::lockPiece(g);
+                ref.lock(a);
+                ++locked;
+                if (!Agree(g, ref, name, "lock", k)) break;
+                int c = game::clearLines(g), rc = ref.clearLines();
+                cleared += rc;
+                if (c != rc) { Fail("%s: clearLines on board %d: %d, reference %d", name, n, c, rc); break; }
+                if (!Agree(g, ref, name, "clear", k)) break;
+
+                if (rng() % 6 == 0) {
+                    int count = 1 + (int)(rng() % 3), hole = (int)(rng() % W);
+                    game::pushGarbage(g, count, hole);
+                    ref.pushGarbage(count, hole);
+                    if (!Agree(g, ref, name, "garbage", k)) break;
+                }
+            }
+        }
+        std::printf("rules    %-9s %3dx%-3d %7d pieces locked, %6d lines cleared  %s\n", name, W, H, locked, cleared,
+            g_Failures == before ? "ok" : "MISMATCH");
+    }
+
+    // SRS as the guideline draws it, kept apart from PIECES and KICKS so a slip in either shows
+    // up: every rotation state as a picture in its bounding box (y down, 'X' filled), and the
+    // kick offsets of every transition (x right, y up), unkicked first. Piece order IOTSZJL.
+    // Box column c and row r of a piece anchored at (x, y) is cell (x - 1 + c, y + 1 - r).
+    const char* const SRS_STATES[7][4][4] = {
+        { { "....", "XXXX", "....", "...." }, { "..X.", "..X.", "..X.", "..X." },   // I
+          { "....", "....", "XXXX", "...." }, { ".X..", ".X..", ".X..", ".X.." } },
+        { { ".XX", ".XX", "...", "" }, { ".XX", ".XX", "...", "" },                  // O
+          { ".XX", ".XX", "...", "" }, { ".XX", ".XX", "...", "" } },
+        { { ".X.", "XXX", "...", "" }, { ".X.", ".XX", ".X.", "" },                  // T
+          { "...", "XXX", ".X.", "" }, { ".X.", "XX.", ".X.", "" } },
+        { { ".XX", "XX.", "...", "" }, { ".X.", ".XX", "..X", "" },                  // S
+          { "...", ".XX", "XX.", "" }, { "X..", "XX.", ".X.", "" } },
+        { { "XX.", ".XX", "...", "" }, { "..X", ".XX", ".X.", "" },                  // Z
+          { "...", "XX.", ".XX", "" }, { ".X.", "XX.", "X..", "" } },
+        { { "X..", "XXX", "...", "" }, { ".XX", ".X.", ".X.", "" },                  // J
+          { "...", "XXX", "..X", "" }, { ".X.", ".X.", "XX.", "" } },
+        { { "..X", "XXX", "...", "" }, { ".X.", ".X.", ".XX", "" },                  // L
+          { "...", "XXX", "X..", "" }, { "XX.", ".X.", ".X.", "" } },
+    };
+
+    struct SrsKicks { int from, to; int offsets[5][2]; };
+    const SrsKicks SRS_KICKS_JLSTZ[8] = {
+        { 0, 1, { {0,0}, {-1,0}, {-1, 1}, {0,-2}, {-1,-2} } },
+        { 1, 0, { {0,0}, { 1,0}, { 1,-1}, {0, 2}, { 1, 2} } },
+        { 1, 2, { {0,0}, { 1,0}, { 1,-1}, {0, 2}, { 1, 2} } },
+        { 2, 1, { {0,0}, {-1,0}, {-1, 1}, {0,-2}, {-1,-2} } },
+        { 2, 3, { {0,0}, { 1,0}, { 1, 1}, {0,-2}, { 1,-2} } },
+        { 3, 2, { {0,0}, {-1,0}, {-1,-1}, {0, 2}, {-1, 2} } },
+        { 3, 0, { {0,0}, {-1,0}, {-1,-1}, {0, 2}, {-1, 2} } },
+        { 0, 3, { {0,0}, { 1,0}, { 1, 1}, {0,-2}, { 1,-2} } },
+    };
+    const SrsKicks SRS_KICKS_I[8] = {
+        { 0, 1, { {0,0}, {-2,0}, { 1,0}, {-2,-1}, { 1, 2} } },
+        { 1, 0, { {0,0}, { 2,0}, {-1,0}, { 2, 1}, {-1,-2} } },
+        { 1, 2, { {0,0}, {-1,0}, { 2,0}, {-1, 2}, { 2,-1} } },
+        { 2, 1, { {0,0}, { 1,0}, {-2,0}, { 1,-2}, {-2, 1} } },
+        { 2, 3, { {0,0}, { 2,0}, {-1,0}, { 2, 1}, {-1,-2} } },
+        { 3, 2, { {0,0}, {-2,0}, { 1,0}, {-2,-1}, { 1, 2} } },
+        { 3, 0, { {0,0}, { 1,0}, {-2,0}, { 1,-2}, {-2, 1} } },
+        { 0, 3, { {0,0}, {-1,0}, { 2,0}, {-1, 2}, { 2,-1} } },
+    };
+
+    // Cells of a piece per the pictures, sorted
+    std::vector<game::Cell> SrsCells(const game::Active& a) {
+        std::vector<game::Cell> cells;
+        for (int r = 0; r < 4; ++r) for (int c = 0; SRS_STATES[a.type][a.r][r][c]; ++c)
+            if (SRS_STATES[a.type][a.r][r][c] == 'X') cells.push_back({ a.x - 1 + c, a.y + 1 - r });
+        std::sort(cells.begin(), cells.end(), [](game::Cell p, game::Cell q) { return p.y != q.y ? p.y < q.y : p.x < q.x; });
+        return cells;
+    }
+
+    std::vector<game::Cell> GameCells(const game::Active& a) {
+        std::vector<game::Cell> cells;
+        for (const game::Cell& c : game::PIECES[a.type].rot[a.r]) cells.push_back({ a.x + c.x, a.y + c.y });
+        std::sort(cells.begin(), cells.end(), [](game::Cell p, game::Cell q) { return p.y != q.y ? p.y < q.y : p.x < q.x; });
+        return cells;
+    }
+
+    bool SameCells(const std::vector<game::Cell>& a, const std::vector<game::Cell>& b) {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](game::Cell p, game::Cell q) { return p.x == q.x && p.y == q.y; });
+    }
+
+    template <int W, int H>
+    bool SrsCollides(const CellBoard<W, H>& ref, const game::Active& a) {
+        for (const game::Cell& c : SrsCells(a))
+            if (c.x < 0 || c.x >= W || c.y < 0 || (c.y < H && ref.at(c.x, c.y))) return true;
+        return false;
+    }
+
+    // Reference rotation: the index of the test that succeeded (0 = unkicked), -1 if none did
+    template <int W, int H>
+    int SrsRotate(const CellBoard<W, H>& ref, game::Active& a, int dir) {
+        game::Active t = a;
+        t.r = (a.r + (dir > 0 ? 1 : 3)) & 3;
+        if (a.type == 1) { if (SrsCollides(ref, t)) return -1; a = t; return 0; } // O turns in place
+        for (const SrsKicks& k : a.type == 0 ? SRS_KICKS_I : SRS_KICKS_JLSTZ) {
+            if (k.from != a.r || k.to != t.r) continue;
+            for (int i = 0; i < 5; ++i) {
+                game::Active c = t;
+                c.x += k.offsets[i][0]; c.y += k.offsets[i][1];
+                if (!SrsCollides(ref, c)) { a = c; return i; }
+            }
+        }
+        return -1;
+    }
+
+    // game::rotate against the reference from `a` on `ref`'s board; `test` is the test the
+    // reference took (-1: refused)
+    bool RotateAgrees(game::Game& g, const CellBoard<game::BOARD_W, game::BOARD_H>& ref, game::Active a, int dir,
+        const char* what, int* test = nullptr) {
+        game::Active want = a;
+        int t = SrsRotate(ref, want, dir);
+        if (test) *test = t;
+        g.cur = a;
+        bool moved = game::rotate(g, dir);
+        if (moved != (t >= 0) || !(g.cur == (t >= 0 ? want : a)) || !SameCells(GameCells(g.cur), SrsCells(g.cur))) {
+            Fail("srs: %s: type %d r %d at (%d, %d) turning %s: got r %d at (%d, %d)%s, reference r %d at (%d, %d)%s", what,
+                a.type, a.r, a.x, a.y, dir > 0 ? "cw" : "ccw", g.cur.r, g.cur.x, g.cur.y, moved ? "" : " (refused)",
+                want.r, want.x, want.y, t >= 0 ? "" : " (refused)");
+            return false;
+        }
+        return true;
+    }
+
+    // Known answers for the rotation system, from the guideline's pictures and kick tables
+    void TestSrs(int boards, unsigned seed) {
+        constexpr int W = game::BOARD_W, H = game::BOARD_H;
+        const int before = g_Failures;
+        game::Game g;
+        CellBoard<W, H> empty;
+
+        // Every state of every piece has the guideline's cells
+        for (int type = 0; type < 7; ++type) for (int r = 0; r < 4; ++r) {
+            game::Active a{ 4, 10, r, type };
+            if (!SameCells(GameCells(a), SrsCells(a))) Fail("srs: type %d state %d has the wrong cells", type, r);
+        }
+
+        // On an open board the unkicked rotation wins even though every kick test is free too
+        for (int type = 0; type < 7; ++type) for (int r = 0; r < 4; ++r) for (int dir : { +1, -1 }) {
+            int test = -1;
+            RotateAgrees(g, empty, { 4, 10, r, type }, dir, "open board", &test);
+            if (test != 0) Fail("srs: type %d state %d turning %s on an open board needed a kick", type, r, dir > 0 ? "cw" : "ccw");
+        }
+
+        // I against both walls, all 8 transitions: rows 5 .. 14 are free, so only the wall is in the way
+        int wallKicks = 0;
+        for (int r = 0; r < 4; ++r) for (int dir : { +1, -1 }) for (int side = 0; side < 2; ++side) {
+            game::Active a{ 0, 10, r, 0 };
+            for (a.x = side ? W + 2 : -3; SrsCollides(empty, a); a.x += side ? -1 : 1) {}
+            int test = -1;
+            RotateAgrees(g, empty, a, dir, side ? "I at the right wall" : "I at the left wall", &test);
+            wallKicks += test > 0;
+        }
+        if (wallKicks < 8) Fail("srs: only %d of the I wall rotations kicked", wallKicks);
+        // By hand: I vertical (R) flush left, turning to 2, is pushed two columns right (test 3)
+        {
+            g.cur = { -1, 10, 1, 0 };
+            bool moved = game::rotate(g, +1);
+            std::vector<game::Cell> want = { { 0, 9 }, { 1, 9 }, { 2, 9 }, { 3, 9 } };
+            if (!moved || !SameCells(GameCells(g.cur), want)) Fail("srs: I R->2 flush left landed at (%d, %d)", g.cur.x, g.cur.y);
+        }
+
+        // T kicks 4 and 5 (the T-spin triple kicks): the board is filled but for the T and the
+        // one slot the chosen kick reaches, so every earlier test collides
+        int lateKicks = 0;
+        for (int from = 0; from < 4; ++from) for (int dir : { +1, -1 }) for (int k = 3; k < 5; ++k) {
+            game::Active a{ 4, 10, from, 2 }, target = a;
+            target.r = (from + (dir > 0 ? 1 : 3)) & 3;
+            for (const SrsKicks& kk : SRS_KICKS_JLSTZ)
+                if (kk.from == from && kk.to == target.r) { target.x += kk.offsets[k][0]; target.y += kk.offsets[k][1]; }
+            CellBoard<W, H> ref;
+            for (int& c : ref.cells) c = 8;
+            for (const game::Active& p : { a, target }) for (const game::Cell& c : SrsCells(p)) ref.at(c.x, c.y) = 0;
+            g = game::Game{};
+            for (int y = 0; y < H; ++y) for (int x = 0; x < W; ++x) game::setCell(g, x, y, ref.at(x, y) ? 1 : 0);
+            game::recomputeMetrics(g);
+            // Where an earlier test's cells all lie in the two pieces' cells it wins, as it should
+            int test = -1;
+            RotateAgrees(g, ref, a, dir, "T kick", &test);
+            lateKicks += test == k;
+        }
+        if (lateKicks < 8) Fail("srs: only %d of the T kick 4/5 boards reached their kick", lateKicks);
+        // By hand: T flat (0) at (4, 10) turning to R, every test but the fifth blocked: it drops
+        // one column left and two rows down
+        {
+            CellBoard<W, H> ref;
+            for (int& c : ref.cells) c = 8;
+            for (game::Cell c : { game::Cell{ 4, 11 }, { 3, 10 }, { 4, 10 }, { 5, 10 }, { 3, 9 }, { 3, 8 }, { 4, 8 }, { 3, 7 } }) ref.at(c.x, c.y) = 0;
+            g = game::Game{};
+            for (int y = 0; y < H; ++y) for (int x = 0; x < W; ++x) game::setCell(g, x, y, ref.at(x, y) ? 1 : 0);
+            game::recomputeMetrics(g);
+            g.cur = { 4, 10, 0, 2 };
+            bool moved = game::rotate(g, +1);
+            std::vector<game::Cell> want = { { 3, 7 }, { 3, 8 }, { 4, 8 }, { 3, 9 } };
+            if (!moved || !SameCells(GameCells(g.cur), want)) Fail("srs: T 0->R fifth test landed at (%d, %d)", g.cur.x, g.cur.y);
+        }
+
+        // O never moves, however tight it sits
+        for (int n = 0; n < 4; ++n) for (int dir : { +1, -1 }) {
+            game::Active a{ n == 0 ? 0 : (n == 1 ? W - 2 : 4), n == 3 ? 0 : 10, n, 1 };
+            g = game::Game{};
+            for (int y = 0; y < H; ++y) for (int x = 0; x < W; ++x) game::setCell(g, x, y, 1);
+            for (const game::Cell& c : SrsCells(a)) game::setCell(g, c.x, c.y, 0);
+            game::recomputeMetrics(g);
+            g.cur = a;
+            game::rotate(g, dir);
+            if (g.cur.x != a.x || g.cur.y != a.y || !SameCells(GameCells(g.cur), SrsCells(a))) Fail("srs: O moved from (%d, %d)", a.x, a.y);
+        }
+
+        // Random boards, random free positions, both directions
+        std::mt19937 rng{ seed };
+        int kicked = 0, refused = 0, turns = 0;
+        for (int n = 0; n < boards && g_Failures == before; ++n) {
+            CellBoard<W, H> ref;
+            RandomBoard(g, ref, (int)(rng() % (H - 4)), rng);
+            for (int i = 0; i < 200; ++i) {
+                game::Active a{ (int)(rng() % (W + 4)) - 2, (int)(rng() % H), (int)(rng() % 4), (int)(rng() % 7) };
+                if (SrsCollides(ref, a)) continue;
+                int dir = rng() % 2 ? +1 : -1, test = -1;
+                if (!RotateAgrees(g, ref, a, dir, "random board", &test)) break;
+                ++turns; kicked += test > 0; refused += test < 0;
+            }
+        }
+        std::printf("srs      %d turns on random boards (%d kicked, %d refused), I wall kicks %d/16, T kicks 4-5 %d/16  %s\n",
+            turns, kicked, refused, wallKicks, lateKicks, g_Failures == before ? "ok" : "MISMATCH");
+    }
+
+    // legalPlacements (through placementLegal) against collides for every type, rotation and
+    // anchor on and around the board, on random boards with the ring's base moved by garbage.
+    // Which kernel runs depends on the build: 16-bit rows take the AVX2 or SSE2 one, the
+    // other widths the scalar loop.
+    template <int W, int H>
+    void TestPlacements(const char* name, int boards, unsigned seed) {
+        std::mt19937 rng{ seed };
+        game::BasicGame<W, H> g;
+        CellBoard<W, H> ref;
+        game::PlacementMap<W, H> map;
+        const int before = g_Failures;
+        long long checked = 0;
+        for (int n = 0; n < boards && g_Failures == before; ++n) {
+            RandomBoard(g, ref, (int)(rng() % (H + 1)), rng);
+            if (n % 2) game::pushGarbage(g, 1 + (int)(rng() % 5), (int)(rng() % W));
+            for (int type = 0; type < 7 && g_Failures == before; ++type) {
+                game::legalPlacements(g, type, map);
+                for (int r = 0; r < 4; ++r) for (int y = -3; y < H + 6; ++y) for (int x = -3; x < W + 3; ++x) {
+                    game::Active a{ x, y, r, type };
+                    ++checked;
+                    if (game::placementLegal(map, a) == !game::collides(g, a)) continue;
+                    Fail("%s: board %d (row base %d): type %d r %d at (%d, %d) legal %d, collides %d", name, n, g.rowBase,
+                        type, r, x, y, game::placementLegal(map, a), game::collides(g, a));
+                    r = 4; break;
+                }
+            }
+        }
+        const char* kernel = sizeof(typename game::BasicGame<W, H>::Row) != 2 ? "scalar"
+#if defined(__AVX2__)
+            : "AVX2";
+#elif defined(__SSE2__) || defined(_M_X64)
+            : "SSE2";
+#else
+            : "scalar";
+#endif
+        std::printf("places   %-9s %3dx%-3d %7lld anchors (%s): legalPlacements agrees with collides  %s\n", name, W, H,
+            checked, kernel, g_Failures == before ? "ok" : "MISMATCH");
+    }
+
+    // Everything a restored game must share with the game it was saved from
+    bool SameGame(const game::Game& a, const game::Game& b) {
+        constexpr int W = game::BOARD_W, H = game::BOARD_H;
+        for (int y = 0; y < H; ++y) for (int x = 0; x < W; ++x) if (game::cellColor(a, x, y) != game::cellColor(b, x, y)) return false;
+        for (int y = 0; y < H; ++y) if (a.rowFill(y) != b.rowFill(y)) return false;
+        for (int x = 0; x < W; ++x) if (a.heights[x] != b.heights[x] || a.colFill[x] != b.colFill[x]) return false;
+        return a.holes == b.holes && a.deepestWell == b.deepestWell && a.wellColumn == b.wellColumn
+            && a.boardHash == b.boardHash && a.cur == b.cur && a.score == b.score && a.lines == b.lines
+            && a.level == b.level && a.levelIndex == b.levelIndex && a.garbageTicks == b.garbageTicks
+            && a.gameOver == b.gameOver && a.paused == b.paused && a.instantGravity == b.instantGravity
+            && a.bag.queueCount == b.bag.queueCount && a.bag.bagCount == b.bag.bagCount;
+    }
+
+    // Save mid-game once the ring's base has moved and the queue has wrapped, play on, Restore,
+    // and the game must be the one saved: same board, metrics and hash, the same next pieces
+    // and garbage holes, and the same game from there on
+    void TestSnapshots(int games, unsigned seed) {
+        std::mt19937 rng{ seed };
+        ai::Player bot;
+        const int before = g_Failures;
+        int restored = 0;
+        for (int n = 0; n < games && g_Failures == before; ++n) {
+            game::Game g;
+            g.levelIndex = n % 3;
+            game::Simulation sim{ g };
+            sim.Start(rng());
+            int lastHead = g.bag.queueHead;
+            bool wrapped = false;
+            auto play = [&](int pieces) {
+                for (int k = 0; k < pieces && !g.gameOver; ++k) {
+                    bot.PlayPiece(g);
+                    game::MaybeAddGarbage(g, game::TICK_HZ * (int)(rng() % 4));
+                    wrapped = wrapped || g.bag.queueHead < lastHead;
+                    lastHead = g.bag.queueHead;
+                }
+            };
+            for (int k = 0; k < 400 && !g.gameOver && !(wrapped && g.rowBase != 0); ++k) play(1);
+            if (g.gameOver || !wrapped || g.rowBase == 0) continue;
+            play((int)(rng() % 40));
+            if (g.gameOver) continue;
+
+            game::Game saved = g;
+            game::GameSnapshot s;
+            game::Save(g, s);
+            play(1 + (int)(rng() % 60));
+            game::Restore(g, s);
+            ++restored;
+            if (!game::boardConsistent(g) || !game::metricsConsistent(g)) { Fail("snapshot: game %d restores an inconsistent board", n); break; }
+            if (!SameGame(g, saved)) { Fail("snapshot: game %d restores a different game", n); break; }
+            game::Game a = g, b = saved;
+            bool same = true;
+            for (int k = 0; k < 40; ++k) same = same && a.bag.pull() == b.bag.pull() && a.garbageRng.below(1000) == b.garbageRng.below(1000);
+            if (!same) { Fail("snapshot: game %d deals different pieces or garbage after Restore", n); break; }
+
+            // Both copies play the same game from here
+            for (game::Game* c : { &g, &saved }) {
+                for (int k = 0; k < 100 && !c->gameOver; ++k) {
+                    bot.PlayPiece(*c);
+                    game::MaybeAddGarbage(*c, game::TICK_HZ * 2);
+                }
+            }
+            if (!SameGame(g, saved)) { Fail("snapshot: game %d plays out differently after Restore", n); break; }
+        }
+        if (g_Failures == before && restored < games / 2) Fail("snapshot: only %d of %d games reached a wrapped queue and a moved ring", restored, games);
+        std::printf("snapshot %d games saved with the ring moved and the queue wrapped, restored and played on  %s\n",
+            restored, g_Failures == before ? "ok" : "MISMATCH");
+    }
+
+    // Every feature counted cell by cell, straight from the definitions in ai::Features
+    template <int W, int H>
+    ai::Features FeaturesByCells(const game::BasicGame<W, H>& g) {
+        auto at = [&](int x, int y) { return x < 0 || x >= W || y < 0 ? 1 : (y >= H ? 0 : (int)((g.row(y) >> x) & 1)); };
+        ai::Features f{};
+        int heights[W];
+        for (int x = 0; x < W; ++x) {
+            int h = H;
+            while (h > 0 && !at(x, h - 1)) --h;
+            heights[x] = h;
+            bool gapBelow = false;
+            for (int y = 0; y < H; ++y) {
+                if (at(x, y)) f.coveredCells += gapBelow;
+                else if (y < h) { ++f.holes; gapBelow = true; }
+                f.colTransitions += at(x, y) != at(x, y - 1);
+            }
+            int run = 0;
+            for (int y = h; y < H; ++y) {
+                if (at(x - 1, y) && at(x + 1, y)) f.wellSums += ++run;
+                else run = 0;
+            }
+        }
+        for (int y = 0; y < H; ++y) for (int x = 0; x <= W; ++x) f.rowTransitions += at(x - 1, y) != at(x, y);
+        for (int x = 0; x < W; ++x) {
+            int l = x > 0 ? heights[x - 1] : H, r = x < W - 1 ? heights[x + 1] : H;
+            f.aggregateHeight += heights[x];
+            if (x > 0) f.bumpiness += std::abs(heights[x] - l);
+            f.wells += std::max(0, std::min(l, r) - heights[x]);
+        }
+        return f;
+    }
+
+    bool SameFeatures(const ai::Features& a, const ai::Features& b) {
+        return a.aggregateHeight == b.aggregateHeight && a.holes == b.holes && a.bumpiness == b.bumpiness
+            && a.wells == b.wells && a.lines == b.lines && a.coveredCells == b.coveredCells
+            && a.rowTransitions == b.rowTransitions && a.colTransitions == b.colTransitions && a.wellSums == b.wellSums;
+    }
+
+    void PrintFeatures(const char* label, const ai::Features& f) {
+        std::printf("    %-9s height %d holes %d bumpiness %d wells %d covered %d rowT %d colT %d wellSums %d\n", label,
+            f.aggregateHeight, f.holes, f.bumpiness, f.wells, f.coveredCells, f.rowTransitions, f.colTransitions, f.wellSums);
+    }
+
+    // The feature kernels on random boards: ragged stacks from RandomBoard, and column
+    // profiles with holes, overhangs and deep wells
+    template <int W, int H>
+    void TestFeatures(const char* name, int boards, unsigned seed) {
+        std::mt19937 rng{ seed };
+        game::BasicGame<W, H> g;
+        CellBoard<W, H> ref;
+        const int before = g_Failures;
+        for (int n = 0; n < boards && g_Failures == before; ++n) {
+            if (n % 2 == 0) RandomBoard(g, ref, (int)(rng() % (H + 1)), rng);
+            else {
+                g = game::BasicGame<W, H>{};
+                for (int x = 0; x < W; ++x) {
+                    int h = rng() % 5 == 0 ? 0 : (int)(rng() % (H + 1));
+                    for (int y = 0; y < h; ++y) if (rng() % 6 != 0 || y == h - 1) game::setCell(g, x, y, 1);
+                }
+                game::recomputeMetrics(g);
+            }
+            if (rng() % 3 == 0) game::pushGarbage(g, 1 + (int)(rng() % 3), (int)(rng() % W)); // move the ring's base
+
+            ai::Features cells = FeaturesByCells(g), rows{};
+            ai::kernels::fromHeights<W, H>(g.heights, rows);
+            ai::kernels::fromRows(g, rows);
+            rows.holes = g.holes;
+            bool ok = SameFeatures(rows, cells);
+            ai::Features cols{};
+            if constexpr (H <= 64) {
+                ai::kernels::ColumnBits<H> c[W];
+                ai::kernels::transpose(g, c);
+                ai::kernels::fromColumns<W, H>(c, cols);
+                ok = ok && SameFeatures(cols, cells);
+            }
+            if constexpr (W == game::BOARD_W && H == game::BOARD_H) ok = ok && SameFeatures(ai::Measure(g, 0), cells);
+            if (!ok) {
+                Fail("%s: features of board %d disagree", name, n);
+                PrintFeatures("cells", cells);
+                PrintFeatures("rows", rows);
+                if constexpr (H <= 64) PrintFeatures("columns", cols);
+            }
+        }
+        std::printf("features %-9s %3dx%-3d %7d boards: cells, rows%s agree  %s\n", name, W, H, boards,
+            H <= 64 ? ", columns" : "", g_Failures == before ? "ok" : "MISMATCH");
+    }
+
+    // Games played live, recorded, saved and loaded, then re-simulated both ways. The bot's
+    // Driver plays (so games last, clear lines and take garbage), with stretches of random
+    // buttons mixed in, and it idles between moves, so the fast-forward gets used.
+    void TestReplays(int games, unsigned seed) {
+        const char* path = "tetris_test.trp";
+        std::mt19937 rng{ seed };
+        ai::Player bot;
+        ai::Driver driver{ bot };
+        const int before = g_Failures;
+        std::uint64_t ticks = 0;
+        for (int n = 0; n < games && g_Failures == before; ++n) {
+            game::Game live;
+            live.levelIndex = n % 3;
+            live.level = 1 + (int)(rng() % 12);
+            live.instantGravity = n % 5 == 4;
+            game::Simulation sim{ live };
+            std::uint64_t gameSeed = ((std::uint64_t)rng() << 32) | rng();
+            sim.Start(gameSeed);
+            game::ReplayRecorder recorder;
+            recorder.Begin(gameSeed, live);
+            driver.Reset();
+            std::uint8_t noise = 0;
+            int noiseTicks = 0;
+            for (int t = 0; t < game::TICK_HZ * 120 && !live.gameOver; ++t) {
+                if (noiseTicks == 0 && rng() % 400 == 0) noiseTicks = 1 + (int)(rng() % 60);
+                if (noiseTicks && rng() % 8 == 0) noise = (std::uint8_t)(rng() & 0x1F); // no hard drops
+                std::uint8_t inputs = driver.Next(live);
+                if (noiseTicks) { --noiseTicks; inputs = noise; }
+                recorder.Record((std::uint32_t)sim.Tick(), inputs);
+                sim.Step(inputs);
+            }
+            recorder.Finish((std::uint32_t)sim.Tick(), live);
+            ticks += sim.Tick();
+
+            game::Replay r;
+            if (!game::SaveReplay(path, recorder.Get()) || !game::LoadReplay(path, r)) { Fail("replay: save/load of game %d", n); break; }
+            game::Game fast, stepped;
+            bool ok = game::RunReplay(r, fast) && game::StepReplay(r, stepped);
+            for (const game::Game* g : { &fast, &stepped }) {
+                ok = ok && g->boardHash == live.boardHash && g->score == live.score && g->lines == live.lines
+                    && g->gameOver == live.gameOver;
+            }
+            if (!ok) {
+                Fail("replay: game %d (seed %llu) live score %d lines %d, fast-forwarded %d %d, stepped %d %d", n,
+                    (unsigned long long)gameSeed, live.score, live.lines, fast.score, fast.lines, stepped.score, stepped.lines);
+            }
+        }
+
+        // A file of another format version is refused
+        std::FILE* f = std::fopen(path, "r+b");
+        if (f) {
+            std::uint8_t version = 1;
+            std::fseek(f, 4, SEEK_SET);
+            std::fwrite(&version, 1, 1, f);
+            std::fclose(f);
+            game::Replay r;
+            std::printf("  (the next message is expected)\n");
+            std::fflush(stdout);
+            if (game::LoadReplay(path, r)) Fail("replay: a version 1 file was loaded");
+        }
+        std::remove(path);
+        std::printf("replays  %d games, %llu ticks: live, fast-forwarded and stepped agree  %s\n", games,
+            (unsigned long long)ticks, g_Failures == before ? "ok" : "MISMATCH");
+    }
+
+} // namespace
+
+int main() {
+    TestRules<game::BOARD_W, game::BOARD_H>("standard", 400, 60, 1u);
+    TestRules<4, game::BOARD_H>("practice", 200, 60, 2u);
+    TestRules<40, game::BOARD_H>("party", 200, 60, 3u);
+    TestRules<game::BOARD_W, 400>("stress", 20, 400, 4u);
+    TestRules<8, 12>("byte", 200, 60, 5u);
+    TestRules<64, 33>("wide", 100, 60, 6u);
+    TestSrs(400, 7u);
+
+    TestPlacements<game::BOARD_W, game::BOARD_H>("standard", 400, 31u);
+    TestPlacements<4, game::BOARD_H>("practice", 100, 32u);
+    TestPlacements<40, game::BOARD_H>("party", 100, 33u);
+    TestPlacements<game::BOARD_W, 400>("stress", 10, 34u);
+    TestPlacements<8, 12>("byte", 100, 35u);
+    TestPlacements<64, 33>("wide", 50, 36u);
+
+    TestFeatures<game::BOARD_W, game::BOARD_H>("standard", 20000, 11u);
+    TestFeatures<4, game::BOARD_H>("practice", 5000, 12u);
+    TestFeatures<40, game::BOARD_H>("party", 5000, 13u);
+    TestFeatures<game::BOARD_W, 400>("stress", 1000, 14u);
+    TestFeatures<8, 12>("byte", 5000, 15u);
+    TestFeatures<14, 23>("lanes", 5000, 16u);
+    TestFeatures<64, 64>("wide", 2000, 17u);
+
+    TestSnapshots(40, 41u);
+    TestReplays(60, 21u);
+
+    if (g_Failures) std::printf("%d check(s) failed\n", g_Failures);
+    else std::printf("all checks passed\n");
+    return std::min(g_Failures, 100);
+}
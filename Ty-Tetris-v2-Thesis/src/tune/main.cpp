@@ -0,0 +1,358 @@
+// Evaluation weight tuner: CMA-ES over ai::Weights. Every generation samples a population of
+// weight vectors and scores each one by the mean lines the greedy player clears in a set of
+// seeded headless games, all games of all candidates run in parallel on the task scheduler.
+// The candidates of a generation play the same seeds (common random numbers), so they are
+// compared on equal deals; the seeds change from one generation to the next so the weights
+// do not fit one deal. The search state is checkpointed after every generation (--resume
+// picks it up) and the distribution mean, the tuner's estimate of the best weights, is written
+// (as that generation played it, with its score) as a config for tetris_bot/tetris_batch/Tetris --weights.
+// The best single candidate seen so far goes to a second config (--best); its score was won on
+// one generation's seeds, so it flatters it more than the mean's does.
+#include "../ai/Player.h"
+#include "../engine/Scheduler.h"
+#include "../game/Simulation.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace {
+
+    constexpr int N = ai::WEIGHT_COUNT;
+    using Vec = std::array<double, N>;
+    using Mat = std::array<Vec, N>;
+
+    struct Options {
+        int generations = 50, population = 4 + (int)(3 * std::log((double)N));
+        int games = 32, maxPieces = 1000, threads = 0, levelIndex = 0;
+        std::uint64_t seed = 1;
+        double sigma = 0.3;
+        const char* checkpoint = "tune.ckpt";
+        const char* out = "weights.cfg";
+        const char* best = "weights.best.cfg";
+        bool resume = false;
+    };
+
+    // Everything needed to continue a run; sampling is seeded from (seed, generation), so the
+    // random state does not need saving. The games each candidate plays are part of the
+    // fitness, so a run only resumes with the same ones.
+    struct CmaState {
+        std::uint64_t seed = 1;
+        int population = 0, generation = 0;
+        int games = 0, maxPieces = 0, levelIndex = 0;
+        double sigma = 0.3;
+        Vec mean{}, pc{}, ps{};
+        Mat C{};
+        double bestFitness = -1.0;
+        Vec best{};
+    };
+
+    Vec ToVec(const ai::Weights& w) {
+        Vec v{};
+        for (int i = 0; i < N; ++i) v[i] = w.*ai::WEIGHT_FIELDS[i].field;
+        return v;
+    }
+
+    // Scale does not change which placement scores best, so candidates are played at unit length
+    ai::Weights ToWeights(const Vec& v) {
+        double len = 0;
+        for (double x : v) len += x * x;
+        len = std::sqrt(len);
+        ai::Weights w;
+        for (int i = 0; i < N; ++i) w.*ai::WEIGHT_FIELDS[i].field = (float)(len > 0 ? v[i] / len : v[i]);
+        return w;
+    }
+
+    // Symmetric eigendecomposition by cyclic Jacobi rotations: A = V diag(d) V^T
+    void Eigen(const Mat& A, Mat& V, Vec& d) {
+        Mat a = A;
+        for (int i = 0; i < N; ++i) for (int j = 0; j < N; ++j) V[i][j] = i == j;
+        for (int sweep = 0; sweep < 64; ++sweep) {
+            double off = 0;
+            for (int p = 0; p < N; ++p) for (int q = p + 1; q < N; ++q) off += std::fabs(a[p][q]);
+            if (off < 1e-18) break;
+            for (int p = 0; p < N; ++p) for (int q = p + 1; q < N; ++q) {
+                if (std::fabs(a[p][q]) < 1e-300) continue;
+                double theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+                double t = (theta >= 0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1));
+                double c = 1 / std::sqrt(t * t + 1), s = t * c;
+                for (int k = 0; k < N; ++k) {
+                    double kp = a[k][p], kq = a[k][q];
+                    a[k][p] = c * kp - s * kq; a[k][q] = s * kp + c * kq;
+                }
+                for (int k = 0; k < N; ++k) {
+                    double pk = a[p][k], qk = a[q][k];
+                    a[p][k] = c * pk - s * qk; a[q][k] = s * pk + c * qk;
+                }
+                for (int k = 0; k < N; ++k) {
+                    double kp = V[k][p], kq = V[k][q];
+                    V[k][p] = c * kp - s * kq; V[k][q] = s * kp + c * kq;
+                }
+            }
+        }
+        for (int i = 0; i < N; ++i) d[i] = a[i][i];
+    }
+
+    // Standard normal deviates from the game's portable generator (Box-Muller), so a seed
+    // samples the same candidates on every platform
+    struct Normal {
+        game::Rng rng;
+        explicit Normal(std::uint64_t seed) : rng(seed) {}
+        double operator()() {
+            double u1 = ((double)rng() + 1.0) / 4294967296.0, u2 = (double)rng() / 4294967296.0;
+            return std::sqrt(-2 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+        }
+    };
+
+    bool SaveCheckpoint(const char* path, const CmaState& s) {
+        std::string tmp = std::string(path) + ".tmp";
+        std::FILE* f = std::fopen(tmp.c_str(), "w");
+        if (!f) { std::fprintf(stderr, "[Tune] cannot write: %s\n", tmp.c_str()); return false; }
+        auto vec = [&](const char* name, const Vec& v) {
+            std::fprintf(f, "%s", name);
+            for (double x : v) std::fprintf(f, " %.17g", x);
+            std::fprintf(f, "\n");
+        };
+        std::fprintf(f, "tetris_tune 2\nseed %llu\npopulation %d\ngeneration %d\nsigma %.17g\n",
+            (unsigned long long)s.seed, s.population, s.generation, s.sigma);
+        std::fprintf(f, "games %d\npieces %d\nlevel %d\n", s.games, s.maxPieces, s.levelIndex);
+        vec("mean", s.mean); vec("pc", s.pc); vec("ps", s.ps);
+        for (const Vec& row : s.C) vec("C", row);
+        std::fprintf(f, "bestFitness %.17g\n", s.bestFitness);
+        vec("best", s.best);
+        bool ok = std::fclose(f) == 0;
+        // Replace the old checkpoint only once the new one is complete
+        ok = ok && std::rename(tmp.c_str(), path) == 0;
+        if (!ok) std::fprintf(stderr, "[Tune] write fail: %s\n", path);
+        return ok;
+    }
+
+    bool LoadCheckpoint(const char* path, CmaState& s) {
+        std::FILE* f = std::fopen(path, "r");
+        if (!f) { std::fprintf(stderr, "[Tune] cannot open: %s\n", path); return false; }
+        int version = 0;
+        unsigned long long seed = 0;
+        bool ok = std::fscanf(f, " tetris_tune %d seed %llu population %d generation %d sigma %lf",
+            &version, &seed, &s.population, &s.generation, &s.sigma) == 5 && version == 2;
+        ok = ok && std::fscanf(f, " games %d pieces %d level %d", &s.games, &s.maxPieces, &s.levelIndex) == 3;
+        auto vec = [&](const char* name, Vec& v) {
+            char tag[16];
+            ok = ok && std::fscanf(f, " %15s", tag) == 1 && std::strcmp(tag, name) == 0;
+            for (double& x : v) ok = ok && std::fscanf(f, " %lf", &x) == 1;
+        };
+        vec("mean", s.mean); vec("pc", s.pc); vec("ps", s.ps);
+        for (Vec& row : s.C) vec("C", row);
+        ok = ok && std::fscanf(f, " bestFitness %lf", &s.bestFitness) == 1;
+        vec("best", s.best);
+        std::fclose(f);
+        s.seed = seed;
+        if (!ok) std::fprintf(stderr, "[Tune] not a checkpoint (or wrong version): %s\n", path);
+        return ok;
+    }
+
+    // Scratch for one scheduler worker
+    struct Worker {
+        game::Game g;
+        ai::Player player;
+    };
+
+    // Lines cleared by the greedy player with weights w, game seeded with `seed`
+    int PlayGame(Worker& w, const ai::Weights& weights, const Options& o, std::uint64_t seed) {
+        game::Game& g = w.g;
+        g = game::Game{};
+        g.levelIndex = o.levelIndex;
+        g.level = 1 + (o.levelIndex == 0 ? 0 : (o.levelIndex == 1 ? 4 : 9));
+        game::Simulation s{ g };
+        s.Start(seed);
+        w.player.SetWeights(weights);
+        for (int pieces = 0; pieces < o.maxPieces && w.player.PlayPiece(g); ++pieces) {}
+        return g.lines;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--generations") == 0 && i + 1 < argc) o.generations = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--population") == 0 && i + 1 < argc) o.population = std::max(4, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--games") == 0 && i + 1 < argc) o.games = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--pieces") == 0 && i + 1 < argc) o.maxPieces = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--level") == 0 && i + 1 < argc) o.levelIndex = std::clamp(std::atoi(argv[++i]), 0, 2);
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) o.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--sigma") == 0 && i + 1 < argc) o.sigma = std::max(1e-6, std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) o.threads = std::max(0, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) o.checkpoint = argv[++i];
+        else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) o.out = argv[++i];
+        else if (std::strcmp(argv[i], "--best") == 0 && i + 1 < argc) o.best = argv[++i];
+        else if (std::strcmp(argv[i], "--resume") == 0) o.resume = true;
+        else {
+            std::fprintf(stderr, "usage: tetris_tune [--generations G] [--population P] [--games N] [--pieces N]\n"
+                "                   [--level 0-2] [--seed S] [--sigma S] [--threads T]\n"
+                "                   [--checkpoint FILE] [--resume] [--out FILE] [--best FILE]\n");
+            return 2;
+        }
+    }
+
+    CmaState st;
+    if (o.resume) {
+        if (!LoadCheckpoint(o.checkpoint, st)) return 1;
+        if (st.population != o.population || st.games != o.games || st.maxPieces != o.maxPieces
+            || st.levelIndex != o.levelIndex) {
+            std::fprintf(stderr, "[Tune] %s was tuned with --population %d --games %d --pieces %d --level %d; resume with the same\n",
+                o.checkpoint, st.population, st.games, st.maxPieces, st.levelIndex);
+            return 1;
+        }
+        std::printf("resuming %s at generation %d\n", o.checkpoint, st.generation);
+    }
+    else {
+        st.seed = o.seed;
+        st.population = o.population;
+        st.sigma = o.sigma;
+        st.games = o.games;
+        st.maxPieces = o.maxPieces;
+        st.levelIndex = o.levelIndex;
+        st.mean = ToVec(ToWeights(ToVec(ai::Weights{}))); // the hand-picked defaults, at unit length
+        for (int i = 0; i < N; ++i) st.C[i][i] = 1.0;
+    }
+
+    // Strategy parameters (Hansen's defaults)
+    const int lambda = st.population, mu = lambda / 2;
+    std::vector<double> rw(mu);
+    for (int i = 0; i < mu; ++i) rw[i] = std::log(mu + 0.5) - std::log(i + 1.0);
+    double rsum = std::accumulate(rw.begin(), rw.end(), 0.0), rsq = 0;
+    for (double& x : rw) { x /= rsum; rsq += x * x; }
+    const double mueff = 1 / rsq;
+    const double cs = (mueff + 2) / (N + mueff + 5);
+    const double ds = 1 + 2 * std::max(0.0, std::sqrt((mueff - 1) / (N + 1)) - 1) + cs;
+    const double cc = (4 + mueff / N) / (N + 4 + 2 * mueff / N);
+    const double c1 = 2 / ((N + 1.3) * (N + 1.3) + mueff);
+    const double cmu = std::min(1 - c1, 2 * (mueff - 2 + 1 / mueff) / ((N + 2) * (N + 2) + mueff));
+    const double chiN = std::sqrt((double)N) * (1 - 1.0 / (4 * N) + 1.0 / (21 * N * N));
+
+    eng::Scheduler scheduler(o.threads);
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (int i = 0; i < scheduler.Size(); ++i) workers.push_back(std::make_unique<Worker>());
+    std::printf("CMA-ES: %d weights, population %d, %d games x %d pieces each, %d threads\n",
+        N, lambda, o.games, o.maxPieces, scheduler.Size());
+
+    // The mean is played alongside the candidates, on the same seeds, as a progress readout
+    std::vector<Vec> cand(lambda + 1), ys(lambda);
+    std::vector<ai::Weights> played(lambda + 1);
+    std::vector<int> lines((std::size_t)(lambda + 1) * o.games);
+    std::vector<double> fitness(lambda + 1);
+    ai::Weights written;        // the last mean played, and what it scored
+    double writtenFitness = -1;
+
+    for (int end = st.generation + o.generations; st.generation < end; ++st.generation) {
+        auto t0 = std::chrono::steady_clock::now();
+        Mat B; Vec D;
+        Eigen(st.C, B, D);
+        for (double& d : D) d = std::sqrt(std::max(d, 1e-20));
+
+        Normal normal(st.seed * 0x9E3779B97F4A7C15ull + (std::uint64_t)st.generation);
+        for (int k = 0; k < lambda; ++k) {
+            Vec z;
+            for (double& x : z) x = normal();
+            for (int i = 0; i < N; ++i) {
+                ys[k][i] = 0;
+                for (int j = 0; j < N; ++j) ys[k][i] += B[i][j] * D[j] * z[j];
+                cand[k][i] = st.mean[i] + st.sigma * ys[k][i];
+            }
+        }
+        cand[lambda] = st.mean;
+        for (int k = 0; k <= lambda; ++k) played[k] = ToWeights(cand[k]);
+
+        // Common random numbers: game j has the same seed for every candidate
+        const std::uint64_t seedBase = st.seed * 1'000'003ull + (std::uint64_t)st.generation * o.games;
+        scheduler.Run([&] {
+            scheduler.ParallelFor(0, (lambda + 1) * o.games, 1, [&](int job) {
+                int k = job / o.games, j = job % o.games;
+                lines[job] = PlayGame(*workers[eng::Scheduler::WorkerIndex()], played[k], o, seedBase + j);
+            });
+        });
+        for (int k = 0; k <= lambda; ++k) {
+            long long sum = 0;
+            for (int j = 0; j < o.games; ++j) sum += lines[(std::size_t)k * o.games + j];
+            fitness[k] = (double)sum / o.games;
+        }
+
+        // Rank (best first, ties by index) and recombine the best half
+        std::vector<int> order(lambda);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return fitness[a] > fitness[b]; });
+        Vec yw{};
+        for (int r = 0; r < mu; ++r) for (int i = 0; i < N; ++i) yw[i] += rw[r] * ys[order[r]][i];
+        for (int i = 0; i < N; ++i) st.mean[i] += st.sigma * yw[i];
+
+        // Evolution paths; C^-1/2 yw = B D^-1 B^T yw
+        Vec t{}, cinv{};
+        for (int j = 0; j < N; ++j) { for (int i = 0; i < N; ++i) t[j] += B[i][j] * yw[i]; t[j] /= D[j]; }
+        for (int i = 0; i < N; ++i) for (int j = 0; j < N; ++j) cinv[i] += B[i][j] * t[j];
+        double psLen = 0;
+        for (int i = 0; i < N; ++i) {
+            st.ps[i] = (1 - cs) * st.ps[i] + std::sqrt(cs * (2 - cs) * mueff) * cinv[i];
+            psLen += st.ps[i] * st.ps[i];
+        }
+        psLen = std::sqrt(psLen);
+        bool hs = psLen / std::sqrt(1 - std::pow(1 - cs, 2.0 * (st.generation + 1))) / chiN < 1.4 + 2.0 / (N + 1);
+        for (int i = 0; i < N; ++i) st.pc[i] = (1 - cc) * st.pc[i] + (hs ? std::sqrt(cc * (2 - cc) * mueff) : 0.0) * yw[i];
+
+        // Covariance: rank-one update from the path, rank-mu update from the selected steps
+        for (int i = 0; i < N; ++i) for (int j = 0; j < N; ++j) {
+            double rankMu = 0;
+            for (int r = 0; r < mu; ++r) rankMu += rw[r] * ys[order[r]][i] * ys[order[r]][j];
+            st.C[i][j] = (1 - c1 - cmu) * st.C[i][j]
+                + c1 * (st.pc[i] * st.pc[j] + (hs ? 0.0 : cc * (2 - cc) * st.C[i][j]))
+                + cmu * rankMu;
+        }
+        st.sigma *= std::exp(cs / ds * (psLen / chiN - 1));
+
+        // Only the direction matters: keep the mean at unit length
+        st.mean = ToVec(ToWeights(st.mean));
+
+        const int top = order[0];
+        const bool improved = fitness[top] > st.bestFitness;
+        if (improved) { st.bestFitness = fitness[top]; st.best = ToVec(played[top]); }
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        std::printf("gen %4d  best %8.2f  mean %8.2f  (mean weights %8.2f)  sigma %.4f  %.1f s\n", st.generation,
+            fitness[top], std::accumulate(fitness.begin(), fitness.end() - 1, 0.0) / lambda, fitness[lambda], st.sigma, sec);
+        std::fflush(stdout);
+
+        CmaState next = st;
+        ++next.generation;
+        SaveCheckpoint(o.checkpoint, next);
+        // The config is the mean as this generation played it, so the score it is saved with was measured
+        char comment[128];
+        std::snprintf(comment, sizeof comment, "tetris_tune generation %d, seed %llu: mean, %.2f lines/game",
+            st.generation, (unsigned long long)st.seed, fitness[lambda]);
+        ai::SaveWeights(o.out, played[lambda], comment);
+        written = played[lambda];
+        writtenFitness = fitness[lambda];
+        if (improved) {
+            std::snprintf(comment, sizeof comment, "tetris_tune generation %d, seed %llu: best candidate, %.2f lines/game",
+                st.generation, (unsigned long long)st.seed, st.bestFitness);
+            ai::SaveWeights(o.best, ToWeights(st.best), comment);
+        }
+    }
+
+    if (writtenFitness < 0) { std::printf("no generations played; %s left as it was\n", o.out); return 0; }
+    std::printf("best candidate: %.2f lines/game; mean: %.2f lines/game", st.bestFitness, writtenFitness);
+    const ai::Weights& w = written;
+    std::printf("; mean weights written to %s:", o.out);
+    for (const ai::WeightField& wf : ai::WEIGHT_FIELDS) std::printf(" %s %.4f", wf.name, w.*wf.field);
+    std::printf("\n");
+    const ai::Weights b = ToWeights(st.best);
+    std::printf("best candidate weights in %s:", o.best);
+    for (const ai::WeightField& wf : ai::WEIGHT_FIELDS) std::printf(" %s %.4f", wf.name, b.*wf.field);
+    std::printf("\n");
+    return 0;
+}